@@ -0,0 +1,231 @@
+/*
+Copyright (C) Dieter Baron
+
+The authors can be contacted at <fast-ninja@tpau.group>
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+
+2. The names of the authors may not be used to endorse or promote
+  products derived from this software without specific prior
+  written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS
+OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "config.h"
+
+#include "ActionCache.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <random>
+
+#include <tpau-cpp-kernal/Exception.h>
+
+#include "FastNinjaUtil.h"
+#include "Hash.h"
+#include "MappedFile.h"
+
+using namespace tpau::cpp_kernal;
+
+int ActionCache::main(const std::vector<std::string>& arguments) {
+    try {
+        const auto separator = std::ranges::find(arguments, "--");
+        if (separator == arguments.end() || separator - arguments.begin() < 3) {
+            throw Exception("usage: fast-ninja --cached-exec directory size-mb output ... -- input ...");
+        }
+
+        const auto size = parse_number<uint64_t>(arguments[1]);
+        if (!size) {
+            throw Exception("invalid cache size '{}'", arguments[1]);
+        }
+
+        const auto outputs = std::vector<std::filesystem::path>(arguments.begin() + 2, separator);
+        const auto command_filename = command_file(outputs.front());
+        const auto command = MappedFile{ command_filename };
+        if (!command.is_open()) {
+            throw Exception("can't read command from '{}'", command_filename.string());
+        }
+
+        const auto inputs = std::vector<std::filesystem::path>(separator + 1, arguments.end());
+        return ActionCache{ arguments[0], *size * 1024 * 1024 }.run(std::string(command.data()), outputs, inputs);
+    } catch (const std::exception& ex) {
+        std::cerr << "fast-ninja: " << ex.what() << '\n';
+        return 1;
+    }
+}
+
+int ActionCache::run(const std::string& command, const std::vector<std::filesystem::path>& outputs, const std::vector<std::filesystem::path>& inputs) const {
+    const auto cache_key = key(command, outputs, inputs);
+    if (cache_key && restore(entry_directory(*cache_key), outputs)) {
+        return 0;
+    }
+
+    std::cout.flush();
+    if (const auto status = exit_status(std::system(command.c_str())); status != 0) {
+        return status;
+    }
+
+    if (cache_key) {
+        // A cache that can't be written must not fail the build.
+        try {
+            if (grow_size_estimate(store(*cache_key, outputs))) {
+                evict();
+            }
+        } catch (const std::exception& ex) {
+            std::cerr << "fast-ninja: warning: can't update cache: " << ex.what() << '\n';
+        }
+    }
+    return 0;
+}
+
+std::optional<std::string> ActionCache::key(const std::string& command, const std::vector<std::filesystem::path>& outputs, const std::vector<std::filesystem::path>& inputs) {
+    auto hash = Hash{};
+    hash.update(VERSION);
+    hash.update(command);
+    // A rebuilt or updated tool may produce different outputs. Commands that don't start with a program, like shell builtins, can't be tracked.
+    const auto start = command.find_first_not_of(" \t\n");
+    if (const auto program = find_program(start == std::string::npos ? std::string{} : command.substr(start, command.find_first_of(" \t\n", start) - start))) {
+        auto size_error = std::error_code{};
+        auto time_error = std::error_code{};
+        const auto size = std::filesystem::file_size(*program, size_error);
+        const auto modification_time = std::filesystem::last_write_time(*program, time_error);
+        if (!size_error && !time_error) {
+            hash.update(std::filesystem::absolute(*program).generic_string());
+            hash.update(static_cast<uint64_t>(size));
+            hash.update(static_cast<uint64_t>(modification_time.time_since_epoch().count()));
+        }
+    }
+    hash.update(static_cast<uint64_t>(outputs.size()));
+    for (const auto& output : outputs) {
+        hash.update(output.generic_string());
+    }
+    for (const auto& input : inputs) {
+        hash.update(input.generic_string());
+        auto file_hash = Hash{};
+        if (!file_hash.update_file(input)) {
+            return {};
+        }
+        hash.update(file_hash.value());
+    }
+    return hash.string();
+}
+
+std::filesystem::path ActionCache::entry_directory(const std::string& key) const { return directory / key.substr(0, 2) / key; }
+
+bool ActionCache::restore(const std::filesystem::path& entry, const std::vector<std::filesystem::path>& outputs) const {
+    auto error = std::error_code{};
+    if (!std::filesystem::is_directory(entry, error)) {
+        return false;
+    }
+
+    for (size_t index = 0; index < outputs.size(); index++) {
+        std::filesystem::copy_file(entry / std::to_string(index), outputs[index], std::filesystem::copy_options::overwrite_existing, error);
+        if (error) {
+            return false;
+        }
+    }
+    std::filesystem::last_write_time(entry, std::filesystem::file_time_type::clock::now(), error);
+    return true;
+}
+
+uint64_t ActionCache::store(const std::string& key, const std::vector<std::filesystem::path>& outputs) const {
+    // The entry is assembled under a unique name and renamed into place, so concurrent builds never see a partial entry.
+    const auto temporary = directory / "tmp" / (key + "." + std::to_string(std::random_device{}()));
+    std::filesystem::create_directories(temporary);
+    uint64_t size = 0;
+    for (size_t index = 0; index < outputs.size(); index++) {
+        std::filesystem::copy_file(outputs[index], temporary / std::to_string(index));
+        size += std::filesystem::file_size(outputs[index]);
+    }
+
+    const auto entry = entry_directory(key);
+    std::filesystem::create_directories(entry.parent_path());
+    auto error = std::error_code{};
+    std::filesystem::rename(temporary, entry, error);
+    if (error) {
+        // Another build stored the same entry first.
+        std::filesystem::remove_all(temporary);
+        return 0;
+    }
+    return size;
+}
+
+bool ActionCache::grow_size_estimate(uint64_t size) const {
+    auto estimate = uint64_t{ 0 };
+    auto stream = std::ifstream(directory / "size");
+    if (!(stream >> estimate)) {
+        // Without an estimate, the size is only known after a scan.
+        return true;
+    }
+    stream.close();
+
+    // Concurrent builds may lose each other's updates, but each eviction scan corrects the estimate.
+    estimate += size;
+    write_size_estimate(estimate);
+    return estimate > size_limit;
+}
+
+void ActionCache::write_size_estimate(uint64_t size) const {
+    auto stream = std::ofstream(directory / "size");
+    stream << size << '\n';
+}
+
+void ActionCache::evict() const {
+    auto entries = std::vector<std::pair<std::filesystem::file_time_type, std::filesystem::path>>{};
+    auto sizes = std::vector<uint64_t>{};
+    uint64_t total_size = 0;
+
+    for (const auto& prefix : std::filesystem::directory_iterator(directory)) {
+        if (!prefix.is_directory() || prefix.path().filename() == "tmp") {
+            continue;
+        }
+        for (const auto& entry : std::filesystem::directory_iterator(prefix.path())) {
+            uint64_t size = 0;
+            for (const auto& file : std::filesystem::directory_iterator(entry.path())) {
+                size += file.file_size();
+            }
+            entries.emplace_back(entry.last_write_time(), entry.path());
+            total_size += size;
+            sizes.emplace_back(size);
+        }
+    }
+    if (total_size <= size_limit) {
+        write_size_estimate(total_size);
+        return;
+    }
+
+    auto order = std::vector<size_t>(entries.size());
+    for (size_t index = 0; index < order.size(); index++) {
+        order[index] = index;
+    }
+    std::ranges::sort(order, std::less<>{}, [&entries](size_t index) { return entries[index].first; });
+    for (const auto index : order) {
+        if (total_size <= size_limit) {
+            break;
+        }
+        auto error = std::error_code{};
+        std::filesystem::remove_all(entries[index].second, error);
+        if (!error) {
+            total_size -= sizes[index];
+        }
+    }
+    write_size_estimate(total_size);
+}
@@ -0,0 +1,73 @@
+/*
+Copyright (C) Dieter Baron
+
+The authors can be contacted at <fast-ninja@tpau.group>
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+
+2. The names of the authors may not be used to endorse or promote
+  products derived from this software without specific prior
+  written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS
+OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef ACTION_CACHE_H
+#define ACTION_CACHE_H
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <vector>
+
+/*
+ Local cache of the outputs of commands, keyed by a hash of the command, the program it runs and the contents of its inputs.
+ Each entry is a directory named by the key, holding the outputs in order; its modification time records the last use, for least recently used eviction.
+ The file size in the cache directory holds an estimate of the total size of the entries, so they are only scanned when it exceeds the limit.
+ */
+class ActionCache {
+  public:
+    ActionCache(std::filesystem::path directory, uint64_t size_limit) : directory{ std::move(directory) }, size_limit{ size_limit } {}
+
+    // Runs the launcher used by rules with cache = 1: DIRECTORY SIZE-MB OUTPUT ... -- INPUT ...
+    // The command is read from the command file of the first output.
+    static int main(const std::vector<std::string>& arguments);
+
+    [[nodiscard]] static std::filesystem::path command_file(const std::filesystem::path& output) { return output.string() + ".cache-command"; }
+
+    // Restores outputs from the cache, or runs command and stores them. Returns the exit status.
+    int run(const std::string& command, const std::vector<std::filesystem::path>& outputs, const std::vector<std::filesystem::path>& inputs) const;
+
+  private:
+    [[nodiscard]] static std::optional<std::string> key(const std::string& command, const std::vector<std::filesystem::path>& outputs, const std::vector<std::filesystem::path>& inputs);
+    [[nodiscard]] std::filesystem::path entry_directory(const std::string& key) const;
+
+    [[nodiscard]] bool restore(const std::filesystem::path& entry, const std::vector<std::filesystem::path>& outputs) const;
+    // Returns the size of the stored entry, 0 if it was already present.
+    uint64_t store(const std::string& key, const std::vector<std::filesystem::path>& outputs) const;
+    // Returns whether the cache may have grown beyond the limit.
+    [[nodiscard]] bool grow_size_estimate(uint64_t size) const;
+    void write_size_estimate(uint64_t size) const;
+    void evict() const;
+
+    std::filesystem::path directory;
+    uint64_t size_limit;
+};
+
+#endif // ACTION_CACHE_H
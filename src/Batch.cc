@@ -0,0 +1,147 @@
+/*
+Copyright (C) Dieter Baron
+
+The authors can be contacted at <fast-ninja@tpau.group>
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+
+2. The names of the authors may not be used to endorse or promote
+  products derived from this software without specific prior
+  written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS
+OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "Batch.h"
+
+#include <algorithm>
+#include <unordered_map>
+
+#include <tpau-cpp-kernal/DiagnosticOutput.h>
+#include <tpau-cpp-kernal/Exception.h>
+#include <tpau-cpp-kernal/Util.h>
+
+#include "FastNinjaUtil.h"
+#include "File.h"
+#include "Hash.h"
+
+using namespace tpau::cpp_kernal;
+
+Batch::Batch(Tokenizer& tokenizer, Location location) : location{ std::move(location) } {
+    rule_name = tokenizer.expect(Tokenizer::TokenType::WORD, Tokenizer::Skip::SPACE).string();
+    inputs = FilenameList{ tokenizer, FilenameList::INLINE };
+    dependencies = Dependencies{ tokenizer, false };
+    bindings = Bindings{ tokenizer };
+
+    // The batch settings are not passed on to the builds.
+    const auto extension = bindings.take("output_extension");
+    if (!extension) {
+        DiagnosticOutput::global.error(this->location, "batch requires output_extension");
+        throw Exception();
+    }
+    output_extension = extension->string();
+    max_inputs = parse_limit("max_inputs");
+    max_length = parse_limit("max_length");
+}
+
+size_t Batch::parse_limit(const std::string& name) {
+    const auto variable = bindings.take(name);
+    if (!variable) {
+        return 0;
+    }
+    const auto value = variable->string();
+    const auto limit = parse_number<size_t>(value);
+    if (!limit) {
+        DiagnosticOutput::global.error(location, "invalid {} '{}'", name, value);
+        throw Exception();
+    }
+    return *limit;
+}
+
+void Batch::expand(const File& file, std::vector<Build>& builds) {
+    // Outputs are named before any file is classified, so the inputs are classified later by the builds.
+    auto result = ResolveResult{};
+    inputs.resolve(ResolveContext{ file, result, false, false });
+    if (!result.unresolved_used_variables.empty()) {
+        DiagnosticOutput::global.error(location, "unresolved variables: {}", join(sorted(result.unresolved_used_variables), ", "));
+        throw Exception();
+    }
+    auto input_files = std::vector<Filename>{};
+    inputs.collect_filenames(input_files);
+
+    // Inputs are ordered by a hash of their names, so adding or removing one doesn't shift all others into different chunks.
+    auto hashed_inputs = std::vector<std::pair<uint64_t, Filename>>{};
+    for (auto& input : input_files) {
+        hashed_inputs.emplace_back(Hash{}.update(input.name).value(), std::move(input));
+    }
+    std::ranges::sort(hashed_inputs, [](const auto& a, const auto& b) { return a.first < b.first || (a.first == b.first && a.second.name < b.second.name); });
+
+    auto output_inputs = std::unordered_map<std::string, std::string>{};
+    auto chunk_inputs = std::vector<Filename>{};
+    auto chunk_outputs = std::vector<Filename>{};
+    auto chunk_length = size_t{};
+    for (auto& [hash, input] : hashed_inputs) {
+        auto output = Filename{ location, Filename::Type::BUILD, output_name(input.name) };
+        if (const auto [it, inserted] = output_inputs.emplace(output.name, input.name); !inserted) {
+            DiagnosticOutput::global.error(location, "inputs '{}' and '{}' have the same output '{}'", it->second, input.name, output.name);
+            throw Exception();
+        }
+        const auto length = input.name.size() + output.name.size() + 2;
+        if (!chunk_inputs.empty() && ((max_inputs > 0 && chunk_inputs.size() == max_inputs) || (max_length > 0 && chunk_length + length > max_length))) {
+            add_build(file, builds, std::move(chunk_inputs), std::move(chunk_outputs));
+            chunk_inputs.clear();
+            chunk_outputs.clear();
+            chunk_length = 0;
+        }
+        chunk_inputs.emplace_back(std::move(input));
+        chunk_outputs.emplace_back(std::move(output));
+        chunk_length += length;
+
+        // Chunks also end after inputs chosen by their hash, so chunk boundaries stay in place when other inputs change.
+        if ((max_inputs > 0 && hash % max_inputs == 0) || (max_length > 0 && (hash >> 32) % max_length < length)) {
+            add_build(file, builds, std::move(chunk_inputs), std::move(chunk_outputs));
+            chunk_inputs.clear();
+            chunk_outputs.clear();
+            chunk_length = 0;
+        }
+    }
+    if (!chunk_inputs.empty()) {
+        add_build(file, builds, std::move(chunk_inputs), std::move(chunk_outputs));
+    }
+}
+
+std::string Batch::output_name(const std::string& input) const {
+    // Inputs outside the source directory, or given with an absolute path, are placed in the build directory like the others.
+    auto name = std::filesystem::path{};
+    auto leading = true;
+    for (const auto& component : std::filesystem::path(input).relative_path().lexically_normal()) {
+        if (leading && component == "..") {
+            continue;
+        }
+        leading = false;
+        name /= component;
+    }
+    return replace_extension(name, output_extension).generic_string();
+}
+
+void Batch::add_build(const File& file, std::vector<Build>& builds, std::vector<Filename> chunk_inputs, std::vector<Filename> chunk_outputs) const {
+    auto build_inputs = dependencies;
+    build_inputs.set_direct(FilenameList{ std::move(chunk_inputs) });
+    builds.emplace_back(&file, rule_name, Dependencies{ FilenameList{ std::move(chunk_outputs) } }, std::move(build_inputs), bindings.clone());
+    builds.back().location = location;
+}
@@ -0,0 +1,76 @@
+/*
+Copyright (C) Dieter Baron
+
+The authors can be contacted at <fast-ninja@tpau.group>
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+
+2. The names of the authors may not be used to endorse or promote
+  products derived from this software without specific prior
+  written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS
+OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <string>
+#include <vector>
+
+#include "Bindings.h"
+#include "Build.h"
+#include "Dependencies.h"
+#include "FilenameList.h"
+
+class File;
+
+/*
+ Runs a rule on many inputs with few invocations.
+ The inputs are split into chunks of at most max_inputs files, whose input and output names take at most max_length characters.
+ Which chunk an input goes to depends on a hash of its name, not its position, so adding or removing inputs only changes the chunks next to them.
+ Each chunk becomes one build with the outputs of all its inputs, so ninja reruns only the chunks with changed inputs.
+ Each input has one output in the build directory, named like the input with its extension replaced by output_extension.
+ Leading .. components and the root of absolute inputs are dropped from the output name, so outputs stay inside the build directory.
+ */
+class Batch {
+  public:
+    Batch(Tokenizer& tokenizer, Location location);
+
+    // Adds one build per chunk to builds.
+    void expand(const File& file, std::vector<Build>& builds);
+
+    Location location;
+
+  private:
+    [[nodiscard]] std::string output_name(const std::string& input) const;
+    [[nodiscard]] size_t parse_limit(const std::string& name);
+    void add_build(const File& file, std::vector<Build>& builds, std::vector<Filename> chunk_inputs, std::vector<Filename> chunk_outputs) const;
+
+    std::string rule_name;
+    FilenameList inputs;
+    // Implicit, order-only and validation dependencies shared by all chunks.
+    Dependencies dependencies;
+    Bindings bindings;
+    std::string output_extension;
+    // 0 for no limit.
+    size_t max_inputs{};
+    size_t max_length{};
+};
+
+#endif // BATCH_H
@@ -48,17 +48,18 @@ Bindings::Bindings(Tokenizer& tokenizer) {
     }
 
     while (((token = tokenizer.next(Tokenizer::Skip::SPACE))) && token.type != Tokenizer::TokenType::END_SCOPE) {
-        if (token.type != Tokenizer::TokenType::WORD) {
+        // Keywords are valid variable names in bindings, e.g. pool.
+        if (token.type != Tokenizer::TokenType::WORD && !token.is_keyword()) {
             DiagnosticOutput::global.error(token.location, "invalid variable name");
             throw Exception();
         }
         auto name = token.string();
         token = tokenizer.next(Tokenizer::Skip::SPACE);
         if (token.type == Tokenizer::TokenType::ASSIGN) {
-            variables[name] = std::unique_ptr<Variable>(new TextVariable{ name, tokenizer });
+            add(std::unique_ptr<Variable>(new TextVariable{ name, tokenizer }));
         }
         else if (token.type == Tokenizer::TokenType::ASSIGN_LIST) {
-            variables[name] = std::unique_ptr<Variable>(new FilenameVariable{ name, tokenizer });
+            add(std::unique_ptr<Variable>(new FilenameVariable{ name, tokenizer }));
         }
         else {
             DiagnosticOutput::global.error(token.location, "assignment expected");
@@ -67,30 +68,78 @@ Bindings::Bindings(Tokenizer& tokenizer) {
     }
 }
 
-void Bindings::print(std::ostream& stream, const std::string& indent) const {
-    auto variable_names = std::vector<std::string>{};
+void Bindings::add(std::unique_ptr<Variable> variable) {
+    auto it = variables.begin() + (lower_bound(variable->name) - variables.cbegin());
+    if (it != variables.end() && (*it)->name == variable->name) {
+        *it = std::move(variable);
+    }
+    else {
+        variables.insert(it, std::move(variable));
+    }
+}
+
+Bindings Bindings::clone() const {
+    auto copy = Bindings{};
+    copy.variables.reserve(variables.size());
+    for (const auto& variable : variables) {
+        copy.variables.emplace_back(variable->clone());
+    }
+    return copy;
+}
+
+Variable* Bindings::find(std::string_view name) const {
+    auto it = lower_bound(name);
+    if (it != variables.end() && (*it)->name == name) {
+        return it->get();
+    }
+    return nullptr;
+}
 
-    for (auto& pair : *this) {
-        variable_names.emplace_back(pair.first);
+std::unique_ptr<Variable> Bindings::take(std::string_view name) {
+    auto it = variables.begin() + (lower_bound(name) - variables.cbegin());
+    if (it == variables.end() || (*it)->name != name) {
+        return {};
     }
+    auto variable = std::move(*it);
+    variables.erase(it);
+    return variable;
+}
+
+std::vector<std::unique_ptr<Variable>>::const_iterator Bindings::lower_bound(std::string_view name) const {
+    return std::ranges::lower_bound(variables, name, std::less<>{}, [](const auto& variable) { return std::string_view{ variable->name }; });
+}
 
-    std::sort(variable_names.begin(), variable_names.end());
+void Bindings::print(OutputBuffer& output, std::string_view indent) const {
+    for (const auto& variable : variables) {
+        output << indent;
+        variable->print_definition(output);
+    }
+}
+
+void Bindings::print(OutputBuffer& output, std::string_view indent, const StringSet& names) const {
+    for (const auto& variable : variables) {
+        if (names.contains(variable->name)) {
+            output << indent;
+            variable->print_definition(output);
+        }
+    }
+}
 
-    for (const auto& variable : variable_names) {
-        stream << indent;
-        variables.find(variable)->second->print_definition(stream);
+void Bindings::collect_variable_references(StringSet& names) const {
+    for (const auto& variable : variables) {
+        variable->collect_variable_references(names);
     }
 }
 
 void Bindings::resolve(const Scope& scope, bool expand_variables, bool classify_filenames) {
-    auto dependencies = VariableDependencies(variables);
+    auto dependencies = VariableDependencies(*this);
     ResolveResult result;
     auto context = ResolveContext{ scope, result, expand_variables, classify_filenames };
 
     while (!dependencies.finished()) {
         for (auto& name : dependencies.get_next()) {
             result.unresolved_used_variables.clear();
-            variables[name]->resolve(context);
+            find(name)->resolve(context);
             dependencies.update(name, result.unresolved_used_variables);
         }
     }
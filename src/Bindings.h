@@ -30,8 +30,11 @@ IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #ifndef BINDINGS_H
 #define BINDINGS_H
 
-#include <unordered_map>
+#include <memory>
+#include <string_view>
+#include <vector>
 
+#include "FastNinjaUtil.h"
 #include "Tokenizer.h"
 #include "Variable.h"
 
@@ -42,27 +45,31 @@ class Bindings {
     Bindings() = default;
     explicit Bindings(Tokenizer& tokenizer);
 
-    void print(std::ostream& stream, const std::string& indent) const;
+    void print(OutputBuffer& output, std::string_view indent) const;
+    // Prints only the variables whose names are in names.
+    void print(OutputBuffer& output, std::string_view indent, const StringSet& names) const;
     void resolve(const Scope& scope, bool expand_variables = true, bool classify_variables = true);
 
-    void add(std::shared_ptr<Variable> variable) { variables[variable->name] = std::move(variable); }
+    void add(std::unique_ptr<Variable> variable);
+    [[nodiscard]] Bindings clone() const;
 
     [[nodiscard]] auto empty() const { return variables.empty(); }
-
-    auto begin() { return variables.begin(); }
-
-    auto end() { return variables.end(); }
+    [[nodiscard]] auto size() const { return variables.size(); }
 
     [[nodiscard]] auto begin() const { return variables.begin(); }
-
     [[nodiscard]] auto end() const { return variables.end(); }
 
-    auto find(const std::string& name) { return variables.find(name); }
+    [[nodiscard]] Variable* find(std::string_view name) const;
+    // Removes the variable and returns it, or nullptr if there is none.
+    std::unique_ptr<Variable> take(std::string_view name);
 
-    [[nodiscard]] auto find(const std::string& name) const { return variables.find(name); }
+    void collect_variable_references(StringSet& names) const;
 
   private:
-    std::unordered_map<std::string, std::shared_ptr<Variable>> variables;
+    // Sorted by name, so lookup is a binary search and printing needs no sort.
+    std::vector<std::unique_ptr<Variable>> variables;
+
+    [[nodiscard]] std::vector<std::unique_ptr<Variable>>::const_iterator lower_bound(std::string_view name) const;
 };
 
 #endif // BINDINGS_H
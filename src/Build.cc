@@ -29,13 +29,17 @@ IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "Build.h"
 
+#include <tpau-cpp-kernal/DiagnosticOutput.h>
 #include <tpau-cpp-kernal/Exception.h>
 
+#include "ActionCache.h"
+#include "FastNinjaUtil.h"
 #include "File.h"
+#include "TextVariable.h"
 
 using namespace tpau::cpp_kernal;
 
-Build::Build(const File* file, Tokenizer& tokenizer) : ScopedDirective(file) {
+Build::Build(const File* file, Tokenizer& tokenizer, Location location) : ScopedDirective(file), location{ std::move(location) } {
     outputs = Dependencies{ tokenizer, true };
     tokenizer.expect(Tokenizer::TokenType::COLON, Tokenizer::Skip::SPACE);
     rule_name = tokenizer.expect(Tokenizer::TokenType::WORD, Tokenizer::Skip::SPACE).string();
@@ -45,7 +49,7 @@ Build::Build(const File* file, Tokenizer& tokenizer) : ScopedDirective(file) {
 
 Build::Build(const File* file, std::string rule_name, Dependencies outputs, Dependencies inputs, Bindings bindings) : ScopedDirective{ file, std::move(bindings) }, rule_name{ std::move(rule_name) }, outputs{ std::move(outputs) }, inputs{ std::move(inputs) } {}
 
-void Build::collect_output_files(std::unordered_set<std::string>& output_files) const {
+void Build::collect_output_files(PathSet& output_files) const {
     if (!is_phony()) {
         outputs.collect_output_files(output_files);
     }
@@ -60,11 +64,60 @@ void Build::process(const File& file) {
     }
     inputs.resolve(file);
     bindings.resolve(file);
+    if (const auto dyndep = bindings.find("dyndep")) {
+        process_dyndep(file, dyndep->string());
+    }
+    if (rule && rule->is_cached() && !file.top_file()->options.cache_directory.empty()) {
+        add_cache_bindings();
+    }
+    if (const auto pool = bindings.find("pool"); pool && !file.is_valid_pool(pool->string())) {
+        DiagnosticOutput::global.error(location, "unknown pool '{}'", pool->string());
+        throw Exception();
+    }
+}
+
+// Provides the variables used by the command of a cached rule, see Rule::wrap_in_cache.
+void Build::add_cache_bindings() {
+    auto output_files = std::vector<Filename>{};
+    auto input_files = std::vector<Filename>{};
+    outputs.collect_content_filenames(output_files);
+    inputs.collect_content_filenames(input_files);
+
+    // Unlike $in and $out, ninja doesn't quote variables for the shell.
+    const auto quoted_list = [](const std::vector<Filename>& files) {
+        auto words = std::vector<Word>{};
+        for (const auto& file : files) {
+            if (!words.empty()) {
+                words.emplace_back(" ", false);
+            }
+            words.emplace_back(shell_quote(file.full_name().generic_string()), true);
+        }
+        return Text{ std::move(words) };
+    };
+
+    bindings.add(std::make_unique<TextVariable>("cache_command", Text{ ActionCache::command_file(output_files.front().full_name()).generic_string(), true }));
+    bindings.add(std::make_unique<TextVariable>("cache_inputs", quoted_list(input_files)));
+    bindings.add(std::make_unique<TextVariable>("cache_outputs", quoted_list(output_files)));
+}
+
+void Build::process_dyndep(const File& file, const std::string& name) {
+    // Dyndep files are written during the build, so they are always build files.
+    auto filename = Filename{ location, Filename::Type::BUILD, name };
+    auto result = ResolveResult{};
+    filename.resolve(ResolveContext{ file, result });
+    if (!file.is_output_file(filename.full_name())) {
+        DiagnosticOutput::global.error(location, "dyndep file '{}' is not created by any build", filename.full_name().generic_string());
+        throw Exception();
+    }
+
+    // ninja requires the dyndep file to be an input, so it is loaded before the build runs.
+    inputs.add_order_dependency(filename);
+    bindings.add(std::make_unique<TextVariable>("dyndep", Text{ filename.full_name().generic_string(), true }));
 }
 
 void Build::process_outputs(const File& file) { outputs.resolve(file); }
 
-void Build::print(std::ostream& stream) const {
-    stream << std::endl << "build " << outputs << " : " << rule_name << " " << inputs << std::endl;
-    bindings.print(stream, "    ");
+void Build::print(OutputBuffer& output) const {
+    output << "\nbuild " << outputs << " : " << rule_name << ' ' << inputs << '\n';
+    bindings.print(output, "    ");
 }
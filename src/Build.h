@@ -30,27 +30,39 @@ IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #ifndef BUILD_H
 #define BUILD_H
 
-#include <unordered_set>
-
 #include "Bindings.h"
 #include "Dependencies.h"
+#include "PathSet.h"
 #include "Rule.h"
 #include "ScopedDirective.h"
 
 class Build : public ScopedDirective {
   public:
-    explicit Build(const File* file, Tokenizer& tokenizer);
+    Build(const File* file, Tokenizer& tokenizer, Location location);
     Build(const File* file, std::string rule_name, Dependencies outputs, Dependencies inputs, Bindings bindings);
 
+    // The build regenerating the ninja files, which fast-ninja adds itself.
+    [[nodiscard]] bool is_generator() const { return rule_name == "fast-ninja"; }
     [[nodiscard]] bool is_phony() const { return rule_name == "phony"; }
+    [[nodiscard]] const Rule* get_rule() const { return rule; }
+    [[nodiscard]] const std::string& get_rule_name() const { return rule_name; }
 
     void process(const File& file);
     void process_outputs(const File& file);
-    void print(std::ostream& stream) const;
+    // Adds filename as implicit input, unless it is an input already.
+    void add_implicit_input(const Filename& filename) { inputs.add_implicit_dependency(filename); }
+    void print(OutputBuffer& output) const;
+
+    void collect_output_files(PathSet& output_files) const;
+    void collect_inputs(std::vector<Filename>& collector) const { inputs.collect_filenames(collector); }
+    void collect_outputs(std::vector<Filename>& collector) const { outputs.collect_filenames(collector); }
 
-    void collect_output_files(std::unordered_set<std::string>& output_files) const;
+    Location location;
 
   private:
+    void add_cache_bindings();
+    void process_dyndep(const File& file, const std::string& name);
+
     const Rule* rule{};
     std::string rule_name;
     Dependencies outputs;
@@ -0,0 +1,369 @@
+/*
+Copyright (C) Dieter Baron
+
+The authors can be contacted at <fast-ninja@tpau.group>
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+
+2. The names of the authors may not be used to endorse or promote
+  products derived from this software without specific prior
+  written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS
+OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "BuildGraph.h"
+
+#include <algorithm>
+#include <map>
+#include <numeric>
+
+#include "FastNinjaUtil.h"
+#include "File.h"
+#include "NinjaLog.h"
+
+namespace {
+std::string plural(size_t count, const std::string& noun) { return std::to_string(count) + " " + noun + (count == 1 ? "" : "s"); }
+} // namespace
+
+BuildGraph::BuildGraph(const File& file) {
+    add(file);
+
+    // Consumers are counted first, then each build is filed under its inputs.
+    consumer_offsets.assign(node_names.size() + 1, 0);
+    for (const auto node : input_nodes) {
+        consumer_offsets[node + 1] += 1;
+    }
+    std::partial_sum(consumer_offsets.begin(), consumer_offsets.end(), consumer_offsets.begin());
+    consumer_builds.resize(input_nodes.size());
+    auto next = std::vector<uint32_t>(consumer_offsets.begin(), consumer_offsets.end() - 1);
+    for (uint32_t build = 0; build < builds.size(); build++) {
+        for (auto i = input_offsets[build]; i < input_offsets[build + 1]; i++) {
+            consumer_builds[next[input_nodes[i]]++] = build;
+        }
+    }
+}
+
+void BuildGraph::add(const File& file) { // NOLINT(misc-no-recursion)
+    auto filenames = std::vector<Filename>{};
+
+    for (const auto& build : file.get_builds()) {
+        if (build.is_generator()) {
+            continue;
+        }
+        const auto index = static_cast<uint32_t>(builds.size());
+        builds.emplace_back(&build);
+
+        filenames.clear();
+        build.collect_inputs(filenames);
+        for (const auto& filename : filenames) {
+            input_nodes.emplace_back(node(filename.full_name().generic_string()));
+        }
+        input_offsets.emplace_back(static_cast<uint32_t>(input_nodes.size()));
+
+        filenames.clear();
+        build.collect_outputs(filenames);
+        for (const auto& filename : filenames) {
+            const auto output = node(filename.full_name().generic_string());
+            output_nodes.emplace_back(output);
+            if (producers[output] == none) {
+                producers[output] = index;
+            }
+            else {
+                duplicate_outputs.emplace_back(output, index);
+            }
+        }
+        output_offsets.emplace_back(static_cast<uint32_t>(output_nodes.size()));
+    }
+
+    for (const auto& subfile : file.get_subfiles()) {
+        add(*subfile);
+    }
+}
+
+std::unordered_set<const Build*> BuildGraph::needed_builds(const std::vector<std::string>& roots) const {
+    auto needed = std::vector<bool>(builds.size(), false);
+    auto stack = std::vector<uint32_t>{};
+    const auto need = [&](uint32_t node) {
+        const auto build = producers[node];
+        if (build != none && !needed[build]) {
+            needed[build] = true;
+            stack.emplace_back(build);
+        }
+    };
+
+    for (const auto& root : roots) {
+        if (const auto it = node_ids.find(root); it != node_ids.end()) {
+            need(it->second);
+        }
+    }
+    while (!stack.empty()) {
+        const auto build = stack.back();
+        stack.pop_back();
+        for (auto i = input_offsets[build]; i < input_offsets[build + 1]; i++) {
+            need(input_nodes[i]);
+        }
+    }
+
+    auto result = std::unordered_set<const Build*>{};
+    for (uint32_t build = 0; build < builds.size(); build++) {
+        if (needed[build]) {
+            result.insert(builds[build]);
+        }
+    }
+    return result;
+}
+
+uint32_t BuildGraph::node(std::string_view name) {
+    if (const auto it = node_ids.find(name); it != node_ids.end()) {
+        return it->second;
+    }
+    const auto id = static_cast<uint32_t>(node_names.size());
+    node_ids.emplace(node_names.emplace_back(name), id);
+    producers.emplace_back(none);
+    return id;
+}
+
+void BuildGraph::analyze(std::vector<uint32_t>& depth, std::vector<uint32_t>& next_in_chain, std::vector<std::vector<uint32_t>>& cycles) const {
+    enum class State : uint8_t { NEW, ACTIVE, DONE };
+
+    auto state = std::vector<State>(builds.size(), State::NEW);
+    depth.assign(builds.size(), 1);
+    next_in_chain.assign(builds.size(), none);
+
+    const auto extend_chain = [&](uint32_t build, uint32_t dependency) {
+        if (depth[dependency] + 1 > depth[build]) {
+            depth[build] = depth[dependency] + 1;
+            next_in_chain[build] = dependency;
+        }
+    };
+
+    // Iterative depth first search from each build to the builds producing its inputs. The stack holds the build and the next input to visit.
+    auto stack = std::vector<std::pair<uint32_t, uint32_t>>{};
+    for (uint32_t root = 0; root < builds.size(); root++) {
+        if (state[root] != State::NEW) {
+            continue;
+        }
+        stack.emplace_back(root, input_offsets[root]);
+        state[root] = State::ACTIVE;
+
+        while (!stack.empty()) {
+            auto& [build, input] = stack.back();
+            if (input == input_offsets[build + 1]) {
+                const auto finished = build;
+                state[finished] = State::DONE;
+                stack.pop_back();
+                if (!stack.empty()) {
+                    extend_chain(stack.back().first, finished);
+                }
+                continue;
+            }
+
+            const auto producer = producers[input_nodes[input++]];
+            if (producer == none) {
+                continue;
+            }
+            switch (state[producer]) {
+                case State::NEW:
+                    state[producer] = State::ACTIVE;
+                    stack.emplace_back(producer, input_offsets[producer]);
+                    break;
+
+                case State::ACTIVE: {
+                    // Back edge: the cycle consists of the builds on the stack from producer up.
+                    auto& cycle = cycles.emplace_back();
+                    auto it = std::ranges::find_if(stack, [producer](const auto& entry) { return entry.first == producer; });
+                    for (; it != stack.end(); ++it) {
+                        cycle.emplace_back(it->first);
+                    }
+                    break;
+                }
+
+                case State::DONE:
+                    extend_chain(build, producer);
+                    break;
+            }
+        }
+    }
+}
+
+std::string BuildGraph::describe(uint32_t build) const {
+    auto description = output_offsets[build] < output_offsets[build + 1] ? node_names[output_nodes[output_offsets[build]]] : std::string{};
+    const auto location = builds[build]->location.to_string();
+    if (!location.empty()) {
+        description += " (" + location + ")";
+    }
+    return description;
+}
+
+void BuildGraph::print_analysis(OutputBuffer& output, size_t count) const {
+    auto depth = std::vector<uint32_t>{};
+    auto next_in_chain = std::vector<uint32_t>{};
+    auto cycles = std::vector<std::vector<uint32_t>>{};
+    analyze(depth, next_in_chain, cycles);
+
+    if (!builds.empty()) {
+        auto build = static_cast<uint32_t>(std::ranges::max_element(depth) - depth.begin());
+        output << "longest chain: " << plural(depth[build], "build") << '\n';
+        for (; build != none; build = next_in_chain[build]) {
+            output << "    " << describe(build) << '\n';
+        }
+    }
+
+    auto by_fan_in = std::vector<uint32_t>(builds.size());
+    std::iota(by_fan_in.begin(), by_fan_in.end(), 0);
+    const auto fan_in = [this](uint32_t build) { return input_offsets[build + 1] - input_offsets[build]; };
+    std::ranges::stable_sort(by_fan_in, std::greater<>{}, fan_in);
+    output << "largest fan-in:\n";
+    for (size_t i = 0; i < std::min(count, by_fan_in.size()) && fan_in(by_fan_in[i]) > 0; i++) {
+        output << "    " << plural(fan_in(by_fan_in[i]), "input") << ": " << describe(by_fan_in[i]) << '\n';
+    }
+
+    auto by_fan_out = std::vector<uint32_t>(node_names.size());
+    std::iota(by_fan_out.begin(), by_fan_out.end(), 0);
+    const auto fan_out = [this](uint32_t node) { return consumer_offsets[node + 1] - consumer_offsets[node]; };
+    std::ranges::stable_sort(by_fan_out, std::greater<>{}, fan_out);
+    output << "largest fan-out:\n";
+    for (size_t i = 0; i < std::min(count, by_fan_out.size()) && fan_out(by_fan_out[i]) > 0; i++) {
+        output << "    " << plural(fan_out(by_fan_out[i]), "consumer") << ": " << node_names[by_fan_out[i]] << '\n';
+    }
+
+    if (!duplicate_outputs.empty()) {
+        output << "duplicate outputs:\n";
+        for (const auto& [node, build] : duplicate_outputs) {
+            output << "    " << node_names[node] << ": " << describe(producers[node]) << ", " << describe(build) << '\n';
+        }
+    }
+
+    if (!cycles.empty()) {
+        output << "cycles:\n";
+        for (const auto& cycle : cycles) {
+            output << "   ";
+            for (const auto build : cycle) {
+                output << ' ' << describe(build) << " ->";
+            }
+            output << ' ' << describe(cycle.front()) << '\n';
+        }
+    }
+}
+
+std::vector<uint32_t> BuildGraph::topological_order() const {
+    auto missing_inputs = std::vector<uint32_t>(builds.size(), 0);
+    for (uint32_t build = 0; build < builds.size(); build++) {
+        for (auto i = input_offsets[build]; i < input_offsets[build + 1]; i++) {
+            if (producers[input_nodes[i]] != none) {
+                missing_inputs[build] += 1;
+            }
+        }
+    }
+
+    auto order = std::vector<uint32_t>{};
+    for (uint32_t build = 0; build < builds.size(); build++) {
+        if (missing_inputs[build] == 0) {
+            order.emplace_back(build);
+        }
+    }
+    for (size_t next = 0; next < order.size(); next++) {
+        const auto build = order[next];
+        for (auto i = output_offsets[build]; i < output_offsets[build + 1]; i++) {
+            const auto output = output_nodes[i];
+            if (producers[output] != build) {
+                continue;
+            }
+            for (auto j = consumer_offsets[output]; j < consumer_offsets[output + 1]; j++) {
+                if (--missing_inputs[consumer_builds[j]] == 0) {
+                    order.emplace_back(consumer_builds[j]);
+                }
+            }
+        }
+    }
+
+    return order;
+}
+
+void BuildGraph::print_tuning(OutputBuffer& output, const NinjaLog& log, size_t count) const {
+    auto weight = std::vector<uint64_t>(builds.size(), 0);
+    for (uint32_t build = 0; build < builds.size(); build++) {
+        for (auto i = output_offsets[build]; i < output_offsets[build + 1]; i++) {
+            weight[build] = std::max(weight[build], log.duration(node_names[output_nodes[i]]).value_or(0));
+        }
+    }
+
+    // The priority of a build is the time from its start to the end of the build, if everything after it runs in parallel.
+    auto priority = weight;
+    auto next_on_path = std::vector<uint32_t>(builds.size(), none);
+    const auto order = topological_order();
+    for (auto it = order.rbegin(); it != order.rend(); ++it) {
+        const auto build = *it;
+        for (auto i = output_offsets[build]; i < output_offsets[build + 1]; i++) {
+            const auto node = output_nodes[i];
+            for (auto j = consumer_offsets[node]; j < consumer_offsets[node + 1]; j++) {
+                const auto consumer = consumer_builds[j];
+                if (weight[build] + priority[consumer] > priority[build]) {
+                    priority[build] = weight[build] + priority[consumer];
+                    next_on_path[build] = consumer;
+                }
+            }
+        }
+    }
+
+    if (order.empty()) {
+        return;
+    }
+
+    auto build = *std::ranges::max_element(order, std::less<>{}, [&priority](uint32_t build) { return priority[build]; });
+    output << "critical path: " << format_duration(priority[build]) << '\n';
+    for (; build != none; build = next_on_path[build]) {
+        output << "    " << format_duration(weight[build]) << ' ' << describe(build) << '\n';
+    }
+
+    auto by_priority = order;
+    std::ranges::stable_sort(by_priority, std::greater<>{}, [&priority](uint32_t build) { return priority[build]; });
+    output << "highest priority:\n";
+    for (size_t i = 0; i < std::min(count, by_priority.size()) && priority[by_priority[i]] > 0; i++) {
+        output << "    " << format_duration(priority[by_priority[i]]) << ' ' << describe(by_priority[i]) << '\n';
+    }
+
+    // Rules whose runs take far longer than typical are candidates for a pool limiting how many run at once.
+    auto durations = std::vector<uint64_t>{};
+    for (const auto duration : weight) {
+        if (duration > 0) {
+            durations.emplace_back(duration);
+        }
+    }
+    if (durations.empty()) {
+        return;
+    }
+    std::ranges::nth_element(durations, durations.begin() + static_cast<std::ptrdiff_t>(durations.size() / 2));
+    const auto threshold = std::max<uint64_t>(4 * durations[durations.size() / 2], 1000);
+
+    auto long_running = std::map<std::string, std::pair<size_t, uint64_t>>{};
+    for (uint32_t build = 0; build < builds.size(); build++) {
+        if (weight[build] >= threshold) {
+            auto& [runs, total] = long_running[builds[build]->get_rule_name()];
+            runs += 1;
+            total += weight[build];
+        }
+    }
+    if (!long_running.empty()) {
+        output << "long running rules, consider a pool:\n";
+        for (const auto& [rule, statistics] : long_running) {
+            output << "    " << rule << ": " << plural(statistics.first, "build") << ", " << format_duration(statistics.second / statistics.first) << " average\n";
+        }
+    }
+}
@@ -0,0 +1,94 @@
+/*
+Copyright (C) Dieter Baron
+
+The authors can be contacted at <fast-ninja@tpau.group>
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+
+2. The names of the authors may not be used to endorse or promote
+  products derived from this software without specific prior
+  written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS
+OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef BUILD_GRAPH_H
+#define BUILD_GRAPH_H
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "FastNinjaUtil.h"
+#include "OutputBuffer.h"
+
+class Build;
+class File;
+class NinjaLog;
+
+// The dependency graph of all builds in a processed tree, stored in compressed sparse row form.
+// The build regenerating the ninja files is left out, since it isn't part of building the project.
+class BuildGraph {
+  public:
+    explicit BuildGraph(const File& file);
+    BuildGraph(const BuildGraph&) = delete;
+    BuildGraph& operator=(const BuildGraph&) = delete;
+
+    // Reports the longest dependency chain, the builds and files with the largest fan-in and fan-out, duplicate outputs and cycles.
+    void print_analysis(OutputBuffer& output, size_t count = 5) const;
+    // Reports the critical path weighted by the durations from log, the builds with the highest priority, and rules that are candidates for a limited pool.
+    void print_tuning(OutputBuffer& output, const NinjaLog& log, size_t count = 10) const;
+
+    [[nodiscard]] bool has_node(std::string_view name) const { return node_ids.contains(name); }
+    // Returns the builds needed to create roots, directly or through their inputs.
+    [[nodiscard]] std::unordered_set<const Build*> needed_builds(const std::vector<std::string>& roots) const;
+
+  private:
+    static constexpr uint32_t none = UINT32_MAX;
+
+    void add(const File& file);
+    uint32_t node(std::string_view name);
+    // Finds the longest chain of builds ending in each build, and all cycles.
+    void analyze(std::vector<uint32_t>& depth, std::vector<uint32_t>& next_in_chain, std::vector<std::vector<uint32_t>>& cycles) const;
+
+    [[nodiscard]] std::string describe(uint32_t build) const;
+    // Builds in an order where each build comes after all builds producing its inputs. Builds in cycles are omitted.
+    [[nodiscard]] std::vector<uint32_t> topological_order() const;
+
+    std::vector<const Build*> builds;
+    // Names are stored once, node_ids refers to them. A deque keeps them in place as more are added.
+    std::deque<std::string> node_names;
+    std::unordered_map<std::string_view, uint32_t> node_ids;
+
+    // The inputs of build b are input_nodes[input_offsets[b]] to input_nodes[input_offsets[b + 1] - 1], likewise for outputs and consumers of nodes.
+    std::vector<uint32_t> input_offsets{ 0 };
+    std::vector<uint32_t> input_nodes;
+    std::vector<uint32_t> output_offsets{ 0 };
+    std::vector<uint32_t> output_nodes;
+    std::vector<uint32_t> consumer_offsets;
+    std::vector<uint32_t> consumer_builds;
+
+    std::vector<uint32_t> producers;
+    std::vector<std::pair<uint32_t, uint32_t>> duplicate_outputs;
+};
+
+#endif // BUILD_GRAPH_H
@@ -0,0 +1,84 @@
+/*
+Copyright (C) Dieter Baron
+
+The authors can be contacted at <fast-ninja@tpau.group>
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+
+2. The names of the authors may not be used to endorse or promote
+  products derived from this software without specific prior
+  written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS
+OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "BuildLocations.h"
+
+#include <fstream>
+
+#include <tpau-cpp-kernal/Exception.h>
+#include <tpau-cpp-kernal/Util.h>
+
+#include "OutputBuffer.h"
+
+using namespace tpau::cpp_kernal;
+
+BuildLocations BuildLocations::read(const std::filesystem::path& filename) {
+    auto stream = std::ifstream(filename);
+    auto line = std::string{};
+    if (!stream || !std::getline(stream, line)) {
+        throw Exception("can't read build locations '{}', run fast-ninja with --locations", filename.string());
+    }
+
+    auto locations = BuildLocations{ line };
+    while (std::getline(stream, line)) {
+        auto fields = std::vector<std::string>{};
+        size_t start = 0;
+        while (true) {
+            const auto tab = line.find('\t', start);
+            fields.emplace_back(line.substr(start, tab == std::string::npos ? std::string::npos : tab - start));
+            if (tab == std::string::npos) {
+                break;
+            }
+            start = tab + 1;
+        }
+        if (fields.size() < 3) {
+            throw Exception("invalid build locations '{}'", filename.string());
+        }
+        locations.add(std::move(fields[0]), std::move(fields[1]), { std::make_move_iterator(fields.begin() + 2), std::make_move_iterator(fields.end()) });
+    }
+
+    return locations;
+}
+
+void BuildLocations::write(const std::filesystem::path& filename) const {
+    auto output = OutputBuffer{};
+
+    output << source_file.generic_string() << '\n';
+    for (const auto& entry : entries) {
+        output << entry.location << '\t' << entry.rule;
+        for (const auto& file : entry.outputs) {
+            output << '\t' << file;
+        }
+        output << '\n';
+    }
+
+    output.write_if_changed(filename);
+}
+
+std::filesystem::path BuildLocations::filename(const std::filesystem::path& ninja_file) { return replace_extension(ninja_file, "fast-ninja-locations"); }
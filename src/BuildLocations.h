@@ -0,0 +1,67 @@
+/*
+Copyright (C) Dieter Baron
+
+The authors can be contacted at <fast-ninja@tpau.group>
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+
+2. The names of the authors may not be used to endorse or promote
+  products derived from this software without specific prior
+  written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS
+OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef BUILD_LOCATIONS_H
+#define BUILD_LOCATIONS_H
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+/*
+ Map from the builds of one generated ninja file to where they are defined, written next to it, so build times can be traced back to the sources.
+
+ The first line is the source file, followed by one line per build:
+
+ LOCATION TAB RULE TAB OUTPUT [TAB OUTPUT ...]
+ */
+class BuildLocations {
+  public:
+    class Entry {
+      public:
+        std::string location;
+        std::string rule;
+        std::vector<std::string> outputs;
+    };
+
+    BuildLocations() = default;
+    explicit BuildLocations(std::filesystem::path source_file) : source_file{ std::move(source_file) } {}
+
+    [[nodiscard]] static BuildLocations read(const std::filesystem::path& filename);
+    void write(const std::filesystem::path& filename) const;
+
+    void add(std::string location, std::string rule, std::vector<std::string> outputs) { entries.emplace_back(std::move(location), std::move(rule), std::move(outputs)); }
+
+    [[nodiscard]] static std::filesystem::path filename(const std::filesystem::path& ninja_file);
+
+    std::filesystem::path source_file;
+    std::vector<Entry> entries;
+};
+
+#endif // BUILD_LOCATIONS_H
@@ -29,7 +29,7 @@ IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "Dependencies.h"
 
-#include <sstream>
+#include <algorithm>
 
 #include <tpau-cpp-kernal/DiagnosticOutput.h>
 #include <tpau-cpp-kernal/Exception.h>
@@ -83,10 +83,10 @@ void Dependencies::resolve(const Scope& scope) {
     }
 }
 
-void Dependencies::serialize(std::ostream& stream) const {
+void Dependencies::serialize(OutputBuffer& output) const {
     auto first = true;
     if (!direct.empty()) {
-        stream << direct;
+        output << direct;
         first = false;
     }
     if (!implicit.empty()) {
@@ -94,38 +94,68 @@ void Dependencies::serialize(std::ostream& stream) const {
             first = false;
         }
         else {
-            stream << " ";
+            output << ' ';
         }
-        stream << "| " << implicit;
+        output << "| " << implicit;
     }
     if (!order.empty()) {
         if (first) {
             first = false;
         }
         else {
-            stream << " ";
+            output << ' ';
         }
-        stream << "|| " << order;
+        output << "|| " << order;
     }
     if (!validation.empty()) {
         if (first) {
             first = false;
         }
         else {
-            stream << " ";
+            output << ' ';
         }
-        stream << "|@ " << validation;
+        output << "|@ " << validation;
     }
 }
 
-void Dependencies::collect_output_files(std::unordered_set<std::string>& output_files) const {
+void Dependencies::collect_output_files(PathSet& output_files) const {
     direct.collect_output_files(output_files);
     implicit.collect_output_files(output_files);
     order.collect_output_files(output_files);
     validation.collect_output_files(output_files);
 }
 
-std::ostream& operator<<(std::ostream& stream, const Dependencies& dependencies) {
-    dependencies.serialize(stream);
-    return stream;
+void Dependencies::collect_filenames(std::vector<Filename>& collector) const {
+    direct.collect_filenames(collector);
+    implicit.collect_filenames(collector);
+    order.collect_filenames(collector);
+    validation.collect_filenames(collector);
+}
+
+void Dependencies::collect_content_filenames(std::vector<Filename>& collector) const {
+    direct.collect_filenames(collector);
+    implicit.collect_filenames(collector);
+}
+
+void Dependencies::add_order_dependency(const Filename& filename) {
+    if (!contains(filename.full_name())) {
+        order.add(filename);
+    }
+}
+
+void Dependencies::add_implicit_dependency(const Filename& filename) {
+    if (!contains(filename.full_name())) {
+        implicit.add(filename);
+    }
+}
+
+bool Dependencies::contains(const std::filesystem::path& name) const {
+    auto filenames = std::vector<Filename>{};
+    collect_filenames(filenames);
+    return std::ranges::any_of(filenames, [&name](const Filename& dependency) { return dependency.full_name() == name; });
+}
+
+OutputBuffer& operator<<(OutputBuffer& output, const Dependencies& dependencies) {
+    dependencies.serialize(output);
+    return output;
 }
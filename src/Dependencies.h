@@ -45,17 +45,27 @@ class Dependencies {
     Dependencies() = default;
 
     void resolve(const Scope& scope);
-    void collect_output_files(std::unordered_set<std::string>& output_files) const;
+    void collect_output_files(PathSet& output_files) const;
+    void collect_filenames(std::vector<Filename>& collector) const;
+    // Collects the explicit and implicit files, whose contents affect the build.
+    void collect_content_filenames(std::vector<Filename>& collector) const;
+    // Adds filename as order-only dependency, unless it is a dependency already. filename must be resolved.
+    void add_order_dependency(const Filename& filename);
+    // Adds filename as implicit dependency, unless it is a dependency already. filename must be resolved.
+    void add_implicit_dependency(const Filename& filename);
+    void set_direct(FilenameList filenames) { direct = std::move(filenames); }
     void mark_as_build();
-    void serialize(std::ostream& stream) const;
+    void serialize(OutputBuffer& output) const;
 
   private:
+    [[nodiscard]] bool contains(const std::filesystem::path& name) const;
+
     FilenameList direct;
     FilenameList implicit;
     FilenameList order;
     FilenameList validation;
 };
 
-std::ostream& operator<<(std::ostream& stream, const Dependencies& dependencies);
+OutputBuffer& operator<<(OutputBuffer& output, const Dependencies& dependencies);
 
 #endif // DEPENDENCIES_H
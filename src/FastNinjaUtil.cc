@@ -27,22 +27,213 @@ OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
 IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 
-#include <string>
+#include "config.h"
 
-std::string dollar_escape(const std::string& str) {
-    if (str.find_first_of(" $:\n") == std::string::npos) {
-        return str;
+#include "FastNinjaUtil.h"
+
+#include <cstdlib>
+#include <fstream>
+#include <ranges>
+#include <set>
+
+#include <tpau-cpp-kernal/Exception.h>
+
+#ifdef HAVE_SYS_UN_H
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#ifdef HAVE_SYS_WAIT_H
+#include <sys/wait.h>
+#endif
+
+using namespace tpau::cpp_kernal;
+
+#ifdef HAVE_SYS_UN_H
+namespace {
+sockaddr_un socket_address(const std::filesystem::path& path) {
+    auto address = sockaddr_un{};
+    address.sun_family = AF_UNIX;
+    if (path.native().size() >= sizeof(address.sun_path)) {
+        throw Exception("socket path '{}' too long", path.string());
     }
+    std::strcpy(address.sun_path, path.c_str());
+    return address;
+}
+} // namespace
+#endif
+
+std::string format_duration(uint64_t milliseconds) { return std::to_string(milliseconds / 1000) + "." + std::to_string(milliseconds % 1000 / 100) + " s"; }
 
-    std::string escaped;
-    for (char c : str) {
-        if (c == ' ' || c == '$' || c == ':' || c == '\n') {
-            escaped += "$";
-            escaped += c;
+std::vector<std::string> read_lines(const std::filesystem::path& filename) {
+    auto lines = std::vector<std::string>{};
+    auto stream = std::ifstream(filename);
+    auto line = std::string{};
+
+    while (std::getline(stream, line)) {
+        lines.emplace_back(std::move(line));
+    }
+
+    return lines;
+}
+
+std::optional<std::filesystem::path> find_program(const std::string& name) {
+    auto candidates = std::vector<std::filesystem::path>{};
+    if (name.find('/') != std::string::npos) {
+        candidates.emplace_back(name);
+    }
+    else if (const auto path = getenv("PATH")) {
+        // Like execvp, an empty entry is the current directory.
+        auto directories = std::string_view(path);
+        while (true) {
+            const auto colon = directories.find(':');
+            const auto directory = directories.substr(0, colon);
+            candidates.emplace_back(std::filesystem::path(directory.empty() ? "." : directory) / name);
+            if (colon == std::string_view::npos) {
+                break;
+            }
+            directories.remove_prefix(colon + 1);
+        }
+    }
+
+    for (const auto& candidate : candidates) {
+        auto error = std::error_code{};
+        const auto status = std::filesystem::status(candidate, error);
+        if (!error && std::filesystem::is_regular_file(status) && (status.permissions() & (std::filesystem::perms::owner_exec | std::filesystem::perms::group_exec | std::filesystem::perms::others_exec)) != std::filesystem::perms::none) {
+            return candidate;
+        }
+    }
+    return {};
+}
+
+int exit_status(int system_result) {
+#ifdef HAVE_SYS_WAIT_H
+    if (system_result == -1) {
+        return 1;
+    }
+    // Like the shell, report death by a signal as 128 plus the signal number.
+    return WIFEXITED(system_result) ? WEXITSTATUS(system_result) : 128 + WTERMSIG(system_result);
+#else
+    return system_result;
+#endif
+}
+
+std::string shell_quote(std::string_view str) {
+    if (!str.empty() && str.find_first_not_of("abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789_-+./,:@%=") == std::string_view::npos) {
+        return std::string(str);
+    }
+
+    auto quoted = std::string{ "'" };
+    for (const auto c : str) {
+        if (c == '\'') {
+            quoted += "'\\''";
         }
         else {
-            escaped += c;
+            quoted += c;
+        }
+    }
+    quoted += '\'';
+    return quoted;
+}
+
+void remove_files(const std::vector<std::string>& files) {
+    auto directories = std::set<std::filesystem::path>{};
+
+    for (const auto& file : files) {
+        // The list may have been edited, so never remove anything outside the current directory.
+        const auto path = std::filesystem::path(file).lexically_normal();
+        if (path.empty() || path.has_root_path() || *path.begin() == "..") {
+            continue;
         }
+        std::error_code error;
+        if (std::filesystem::remove(path, error)) {
+            for (auto directory = path.parent_path(); !directory.empty(); directory = directory.parent_path()) {
+                if (!directories.insert(directory).second) {
+                    break;
+                }
+            }
+        }
+    }
+
+    // Subdirectories sort after their parents, so removing in reverse order empties children first. Directories that aren't empty are kept.
+    for (const auto& directory : std::views::reverse(directories)) {
+        std::error_code error;
+        std::filesystem::remove(directory, error);
     }
-    return escaped;
 }
+
+#ifdef HAVE_SYS_UN_H
+
+int listen_on_socket(const std::filesystem::path& path) {
+    const auto address = socket_address(path);
+
+    const auto fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        throw Exception("can't create socket: {}", std::strerror(errno));
+    }
+    // A socket left over from a previous server would make bind fail.
+    if (std::filesystem::is_socket(path)) {
+        std::filesystem::remove(path);
+    }
+    if (bind(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) < 0 || listen(fd, SOMAXCONN) < 0) {
+        const auto error = errno;
+        close(fd);
+        throw Exception("can't listen on '{}': {}", path.string(), std::strerror(error));
+    }
+    return fd;
+}
+
+int connect_to_socket(const std::filesystem::path& path) {
+    const auto address = socket_address(path);
+    const auto fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    if (connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+bool write_all(int fd, std::string_view data) {
+    while (!data.empty()) {
+        const auto n = write(fd, data.data(), data.size());
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data.remove_prefix(static_cast<size_t>(n));
+    }
+    return true;
+}
+
+std::ptrdiff_t read_some(int fd, std::string& buffer) {
+    auto chunk = std::array<char, 4096>{};
+    ssize_t n;
+    do {
+        n = read(fd, chunk.data(), chunk.size());
+    } while (n < 0 && errno == EINTR);
+    if (n > 0) {
+        buffer.append(chunk.data(), static_cast<size_t>(n));
+    }
+    return n;
+}
+
+#else
+
+int listen_on_socket(const std::filesystem::path& /*path*/) { throw Exception("Unix domain sockets are not supported on this platform"); }
+
+int connect_to_socket(const std::filesystem::path& /*path*/) { return -1; }
+
+bool write_all(int /*fd*/, std::string_view /*data*/) { return false; }
+
+std::ptrdiff_t read_some(int /*fd*/, std::string& /*buffer*/) { return -1; }
+
+#endif
@@ -30,8 +30,59 @@ OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
 IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <optional>
 #include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
-std::string dollar_escape(const std::string& str);
+// Transparent hash, allows looking up std::string keys by std::string_view without creating a temporary string.
+class StringHash {
+  public:
+    using is_transparent = void;
+
+    size_t operator()(std::string_view str) const { return std::hash<std::string_view>{}(str); }
+};
+
+template <typename T> using StringMap = std::unordered_map<std::string, T, StringHash, std::equal_to<>>;
+using StringSet = std::unordered_set<std::string, StringHash, std::equal_to<>>;
+
+// Formats a duration in milliseconds as seconds with one decimal.
+std::string format_duration(uint64_t milliseconds);
+// Returns the lines of the file, or an empty vector if it doesn't exist.
+std::vector<std::string> read_lines(const std::filesystem::path& filename);
+// Returns the path of the executable program, searching PATH if name contains no slash.
+std::optional<std::filesystem::path> find_program(const std::string& name);
+// Returns the exit status of a command from the result of std::system.
+int exit_status(int system_result);
+// Quotes str for the shell, unless it consists only of characters the shell doesn't interpret.
+std::string shell_quote(std::string_view str);
+// Removes the files and then all directories left empty by that. Absolute paths and paths outside the current directory are skipped.
+void remove_files(const std::vector<std::string>& files);
+
+// Parses all of string as a decimal number.
+template <typename T> std::optional<T> parse_number(std::string_view string) {
+    T value;
+    const auto end = string.data() + string.size();
+    if (const auto result = std::from_chars(string.data(), end, value); result.ec != std::errc{} || result.ptr != end) {
+        return {};
+    }
+    return value;
+}
+
+// Returns a Unix domain socket listening on path. A socket left over from a previous server is replaced, but no other file.
+int listen_on_socket(const std::filesystem::path& path);
+// Returns a Unix domain socket connected to path, or -1 if nobody listens on it.
+int connect_to_socket(const std::filesystem::path& path);
+// Returns false on error.
+bool write_all(int fd, std::string_view data);
+// Returns the number of bytes appended to buffer, 0 at end of file, or -1 on error.
+std::ptrdiff_t read_some(int fd, std::string& buffer);
 
 #endif // FAST_NINJA_UTIL_H
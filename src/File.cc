@@ -27,17 +27,25 @@ OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
 IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 
+#include "config.h"
+
 #include "File.h"
 
 #include <algorithm>
-#include <iostream>
+#include <array>
+#include <iterator>
 #include <ranges>
 
 #include <tpau-cpp-kernal/DiagnosticOutput.h>
 #include <tpau-cpp-kernal/Exception.h>
 #include <tpau-cpp-kernal/Util.h>
 
+#include "BuildGraph.h"
+#include "BuildLocations.h"
+#include "FastNinjaUtil.h"
 #include "FilenameVariable.h"
+#include "Host.h"
+#include "QueryIndex.h"
 #include "TextVariable.h"
 #include "Tokenizer.h"
 
@@ -45,15 +53,34 @@ using namespace std::string_literals;
 
 using namespace tpau::cpp_kernal;
 
+namespace {
+// Variables ninja looks up in the file scope by itself, not only through references.
+constexpr auto ninja_variables = std::array<std::string_view, 13>{ "builddir", "command", "depfile", "deps", "description", "dyndep", "generator", "msvc_deps_prefix", "ninja_required_version", "pool", "restat", "rspfile", "rspfile_content" };
+
+// Each directory's all includes the all of the nearest directories below it.
+std::map<std::filesystem::path, std::vector<std::filesystem::path>> nearest_subdirectories(const std::map<std::filesystem::path, PathSet>& directories) {
+    auto subdirectories = std::map<std::filesystem::path, std::vector<std::filesystem::path>>{};
+    for (const auto& directory : std::views::keys(directories)) {
+        for (auto parent = directory.parent_path(); !parent.empty(); parent = parent.parent_path()) {
+            if (directories.contains(parent)) {
+                subdirectories[parent].emplace_back(directory);
+                break;
+            }
+        }
+    }
+    return subdirectories;
+}
+} // namespace
+
 File::File(const std::filesystem::path& filename, const std::filesystem::path& build_directory, const File* next) : Scope(next), source_filename{ filename }, build_directory{ build_directory.lexically_normal() } {
     source_directory = filename.parent_path();
     build_filename = replace_extension(build_directory / source_filename.filename(), "ninja");
 
-    bindings.add(std::make_shared<FilenameVariable>("build_directory", FilenameList{ Filename{ {}, Filename::Type::COMPLETE, build_directory.string() } }));
-    bindings.add(std::make_shared<FilenameVariable>("source_directory", FilenameList{ Filename{ {}, Filename::Type::COMPLETE, source_directory.string() } }));
+    bindings.add(std::make_unique<FilenameVariable>("build_directory", FilenameList{ Filename{ {}, Filename::Type::COMPLETE, build_directory.string() } }));
+    bindings.add(std::make_unique<FilenameVariable>("source_directory", FilenameList{ Filename{ {}, Filename::Type::COMPLETE, source_directory.string() } }));
     if (is_top()) {
-        bindings.add(std::make_shared<FilenameVariable>("top_build_directory", FilenameList{ Filename{ {}, Filename::Type::COMPLETE, top_file()->build_directory.string() } }));
-        bindings.add(std::make_shared<FilenameVariable>("top_source_directory", FilenameList{ Filename{ {}, Filename::Type::COMPLETE, top_file()->source_directory.string() } }));
+        bindings.add(std::make_unique<FilenameVariable>("top_build_directory", FilenameList{ Filename{ {}, Filename::Type::COMPLETE, top_file()->build_directory.string() } }));
+        bindings.add(std::make_unique<FilenameVariable>("top_source_directory", FilenameList{ Filename{ {}, Filename::Type::COMPLETE, top_file()->source_directory.string() } }));
     }
 
     parse(filename);
@@ -63,24 +90,290 @@ File::File(const std::filesystem::path& filename, const std::filesystem::path& b
     }
 }
 
-void File::process() {
-    auto generator_bindings = Bindings{};
-    generator_bindings.add(std::shared_ptr<Variable>(new TextVariable{ "command", Text{ std::vector<Word>{ Word{ "fast-ninja", false }, Word{ " ", false }, Word{ source_directory.string(), true } } } }));
-    generator_bindings.add(std::shared_ptr<Variable>(new TextVariable{ "generator", Text{ "1", false } }));
+void File::process(bool use_state) {
+    if (options.clean_stale && !built_files_list) {
+        throw Exception("--clean-stale requires built-files-list");
+    }
+
+    auto command = std::vector<Word>{ Word{ "fast-ninja", false } };
+    for (const auto& argument : options.arguments()) {
+        command.emplace_back(" ", false);
+        command.emplace_back(argument, true);
+    }
+    command.emplace_back(" ", false);
+    command.emplace_back(source_directory.string(), true);
 
-    rules["fast-ninja"] = Rule(this, "fast-ninja", generator_bindings);
+    auto generator_bindings = Bindings{};
+    generator_bindings.add(std::unique_ptr<Variable>(new TextVariable{ "command", Text{ command } }));
+    generator_bindings.add(std::unique_ptr<Variable>(new TextVariable{ "generator", Text{ "1", false } }));
+    generator_bindings.add(std::unique_ptr<Variable>(new TextVariable{ "restat", Text{ "1", false } }));
+    // All other files consulted are listed in the depfile.
+    generator_bindings.add(std::unique_ptr<Variable>(new TextVariable{ "depfile", Text{ RegenerationState::depfile_filename(build_directory).lexically_normal().generic_string(), true } }));
+    generator_bindings.add(std::unique_ptr<Variable>(new TextVariable{ "deps", Text{ "gcc", false } }));
+
+    rules.insert_or_assign("fast-ninja", Rule(this, "fast-ninja", std::move(generator_bindings)));
     auto ninja_outputs = std::vector<Filename>{};
-    auto ninja_inputs = std::vector<Filename>{};
-    add_generator_build(ninja_outputs, ninja_inputs);
+    add_generator_outputs(ninja_outputs);
     if (built_files_list) {
         ninja_outputs.emplace_back(*built_files_list);
     }
 
-    builds.emplace_back(this, "fast-ninja", Dependencies{ FilenameList{ ninja_outputs } }, Dependencies{ FilenameList{ ninja_inputs } }, Bindings{});
+    // Everything that affects all generated files: the program version, the options, the structure of the tree and the set of outputs.
+    auto tree_hash = Hash{};
+    tree_hash.update(VERSION);
+    for (const auto& argument : options.arguments()) {
+        tree_hash.update(argument);
+    }
+    for (const auto& filename : ninja_outputs) {
+        tree_hash.update(filename.full_name().generic_string());
+    }
+
+    // ninja pools share one global namespace.
+    auto pool_names = StringMap<const Pool*>{};
+    check_pool_names(pool_names);
 
     process_bindings();
+    expand_batches();
+
+    builds.emplace_back(this, "fast-ninja", Dependencies{ FilenameList{ ninja_outputs } }, Dependencies{ FilenameList{ Filename{ Location{}, Filename::Type::COMPLETE, source_filename.string() } } }, Bindings{});
     process_output();
-    process_rest();
+
+    for (const auto& output : outputs.paths()) {
+        tree_hash.update(output);
+    }
+    // Outputs of phony builds decide which directory targets are generated.
+    auto all_outputs = std::vector<Filename>{};
+    collect_all_outputs(all_outputs);
+    for (const auto& output : all_outputs) {
+        tree_hash.update(output.full_name().generic_string());
+    }
+
+    // Only rules used by builds, and variables left for ninja to expand, are written. They are tracked by name, independently of which files are up to date.
+    collect_rule_names(referenced_rules);
+    referenced_variables.insert(ninja_variables.begin(), ninja_variables.end());
+    collect_variable_references(referenced_rules, referenced_variables);
+    for (const auto& names : { referenced_rules, referenced_variables }) {
+        auto sorted_names = std::vector<std::string>{ names.begin(), names.end() };
+        std::ranges::sort(sorted_names);
+        for (const auto& name : sorted_names) {
+            tree_hash.update(name);
+        }
+    }
+    const auto state = use_state ? RegenerationState{ state_filename() } : RegenerationState{};
+    if (options.prune) {
+        // Which builds are needed depends on the whole graph, so files are checked after pruning.
+        process_rest();
+        prune();
+        add_subdirectory_targets();
+        check_up_to_date(state, Hash{}, tree_hash.value());
+    }
+    else {
+        check_up_to_date(state, Hash{}, tree_hash.value());
+        process_rest();
+        add_subdirectory_targets();
+    }
+}
+
+void File::add_subdirectory_targets() {
+    auto directories = std::map<std::filesystem::path, PathSet>{};
+    collect_directory_outputs(directories);
+    directories.erase(build_directory);
+    add_subdirectory_dependencies(nearest_subdirectories(directories));
+}
+
+void File::add_subdirectory_dependencies(const std::map<std::filesystem::path, std::vector<std::filesystem::path>>& subdirectories) { // NOLINT(misc-no-recursion)
+    auto filenames = std::vector<Filename>{};
+    for (auto& build : builds) {
+        filenames.clear();
+        build.collect_outputs(filenames);
+        for (const auto& filename : filenames) {
+            const auto name = filename.full_name();
+            if (name.filename() != "all") {
+                continue;
+            }
+            if (const auto it = subdirectories.find(name.parent_path()); it != subdirectories.end()) {
+                for (const auto& subdirectory : it->second) {
+                    build.add_implicit_input(Filename{ build.location, Filename::Type::COMPLETE, (subdirectory / "all").generic_string() });
+                }
+            }
+        }
+    }
+
+    for (const auto& file : subfiles) {
+        file->add_subdirectory_dependencies(subdirectories);
+    }
+}
+
+void File::prune() {
+    auto roots = std::vector<std::string>{};
+    collect_defaults(roots);
+    if (roots.empty()) {
+        // Without default statements, ninja builds all outputs nothing else depends on, which needs every build.
+        return;
+    }
+
+    const auto graph = BuildGraph{ *this };
+    for (const auto& root : options.roots) {
+        const auto name = std::filesystem::path(root).lexically_normal().generic_string();
+        if (!graph.has_node(name)) {
+            throw Exception("unknown root '{}'", root);
+        }
+        roots.emplace_back(name);
+    }
+
+    auto needed = graph.needed_builds(roots);
+    // ninja must be able to regenerate the build files. The graph leaves out the generator build.
+    for (const auto& build : builds) {
+        if (build.is_generator()) {
+            needed.insert(&build);
+        }
+    }
+    remove_builds(needed);
+
+    auto used_rules = std::unordered_set<const Rule*>{};
+    collect_used_rules(used_rules);
+    remove_rules(used_rules);
+}
+
+void File::collect_rule_names(StringSet& names) const { // NOLINT(misc-no-recursion)
+    for (const auto& build : builds) {
+        names.insert(build.get_rule_name());
+    }
+
+    for (const auto& file : subfiles) {
+        file->collect_rule_names(names);
+    }
+}
+
+void File::collect_variable_references(const StringSet& rule_names, StringSet& names) const { // NOLINT(misc-no-recursion)
+    for (const auto& [name, rule] : rules) {
+        if (rule_names.contains(name)) {
+            rule.collect_variable_references(names);
+        }
+    }
+
+    for (const auto& file : subfiles) {
+        file->collect_variable_references(rule_names, names);
+    }
+}
+
+void File::collect_defaults(std::vector<std::string>& roots) const { // NOLINT(misc-no-recursion)
+    auto filenames = std::vector<Filename>{};
+    defaults.collect_filenames(filenames);
+    for (const auto& filename : filenames) {
+        roots.emplace_back(filename.full_name().generic_string());
+    }
+
+    for (const auto& file : subfiles) {
+        file->collect_defaults(roots);
+    }
+}
+
+void File::collect_used_rules(std::unordered_set<const Rule*>& used_rules) const { // NOLINT(misc-no-recursion)
+    for (const auto& build : builds) {
+        used_rules.insert(build.get_rule());
+    }
+
+    for (const auto& file : subfiles) {
+        file->collect_used_rules(used_rules);
+    }
+}
+
+void File::remove_builds(const std::unordered_set<const Build*>& needed) { // NOLINT(misc-no-recursion)
+    std::erase_if(builds, [&needed](const Build& build) { return !needed.contains(&build); });
+
+    for (const auto& file : subfiles) {
+        file->remove_builds(needed);
+    }
+}
+
+void File::remove_rules(const std::unordered_set<const Rule*>& used_rules) { // NOLINT(misc-no-recursion)
+    std::erase_if(rules, [&used_rules](const auto& pair) { return !used_rules.contains(&pair.second); });
+
+    for (const auto& file : subfiles) {
+        file->remove_rules(used_rules);
+    }
+}
+
+void File::check_up_to_date(const RegenerationState& state, Hash context, uint64_t tree_hash) { // NOLINT(misc-no-recursion)
+    // Variables and rules are inherited, so a file depends on the sources of all enclosing files.
+    context.update(source_directory.generic_string());
+    context.update(build_directory.generic_string());
+    for (const auto hash : std::views::values(source_hashes)) {
+        context.update(hash);
+    }
+
+    auto file_hash = Hash{ context };
+    if (top_file()->options.prune) {
+        // The builds and rules kept, and the directories below directory targets, also depend on the other files.
+        auto kept_files = std::vector<Filename>{};
+        for (const auto& build : builds) {
+            build.collect_outputs(kept_files);
+            build.collect_inputs(kept_files);
+        }
+        for (const auto& file : kept_files) {
+            file_hash.update(file.full_name().generic_string());
+        }
+        for (const auto& name : std::views::keys(rules)) {
+            file_hash.update(name);
+        }
+    }
+    fingerprint = file_hash.update(tree_hash).value();
+    up_to_date = false;
+
+    if (const auto entry = state.find(build_filename); entry && entry->fingerprint == fingerprint && std::filesystem::exists(build_filename) && std::ranges::all_of(sidecar_filenames(), [](const auto& file) { return std::filesystem::exists(file); })) {
+        up_to_date = entry->is_valid();
+        if (up_to_date) {
+            existence_checks = entry->existence_checks;
+            host_variables = entry->host_variables;
+        }
+    }
+
+    for (const auto& file : subfiles) {
+        file->check_up_to_date(state, context, tree_hash);
+    }
+}
+
+void File::collect_state(RegenerationState& state) const { // NOLINT(misc-no-recursion)
+    state.add(build_filename, RegenerationState::Entry{ fingerprint, existence_checks, host_variables });
+    for (const auto& [file, hash] : source_hashes) {
+        state.add_source(file, hash);
+    }
+    if (built_files_list) {
+        state.add_generated(built_files_list->full_name());
+    }
+    for (const auto& file : sidecar_filenames()) {
+        state.add_generated(file);
+    }
+
+    for (const auto& file : subfiles) {
+        file->collect_state(state);
+    }
+}
+
+bool File::source_exists(const std::filesystem::path& file) const {
+    const auto exists = std::filesystem::exists(file);
+    existence_checks[file.lexically_normal()] = exists;
+    return exists;
+}
+
+void File::check_pool_names(StringMap<const Pool*>& names) const { // NOLINT(misc-no-recursion)
+    for (const auto& pool : std::views::values(pools)) {
+        if (pool.get_name() == Pool::console) {
+            DiagnosticOutput::global.error(pool.location, "pool '{}' is predefined", pool.get_name());
+            throw Exception();
+        }
+        const auto [it, inserted] = names.try_emplace(pool.get_name(), &pool);
+        if (!inserted) {
+            DiagnosticOutput::global.error(pool.location, "duplicate pool '{}'", pool.get_name());
+            DiagnosticOutput::global.error(it->second->location, "previously defined here");
+            throw Exception();
+        }
+    }
+
+    for (const auto& file : subfiles) {
+        file->check_pool_names(names);
+    }
 }
 
 void File::process_bindings() { // NOLINT(misc-no-recursion)
@@ -91,6 +384,16 @@ void File::process_bindings() { // NOLINT(misc-no-recursion)
     }
 }
 
+void File::expand_batches() { // NOLINT(misc-no-recursion)
+    for (auto& batch : batches) {
+        batch.expand(*this, builds);
+    }
+
+    for (const auto& file : subfiles) {
+        file->expand_batches();
+    }
+}
+
 void File::process_output() { // NOLINT(misc-no-recursion)
     auto top_file = const_cast<File*>(top()->as_file());
     if (!top_file) {
@@ -108,21 +411,28 @@ void File::process_output() { // NOLINT(misc-no-recursion)
 }
 
 void File::process_rest() { // NOLINT(misc-no-recursion)
+    // Subfiles may use our variables, so they are always resolved.
     bindings.resolve(*this);
 
-    for (auto& rule : std::views::values(rules)) {
-        rule.process(*this);
-    }
+    if (!up_to_date) {
+        for (auto& pool : std::views::values(pools)) {
+            pool.process(*this);
+        }
 
-    for (auto& build : builds) {
-        build.process(*this);
-    }
+        for (auto& rule : std::views::values(rules)) {
+            rule.process(*this);
+        }
+
+        for (auto& build : builds) {
+            build.process(*this);
+        }
 
-    ResolveResult result;
-    auto context = ResolveContext{ *this, result };
-    defaults.resolve(context);
-    if (!result.unresolved_used_variables.empty()) {
-        // TODO: error: unresolved variables
+        ResolveResult result;
+        auto context = ResolveContext{ *this, result };
+        defaults.resolve(context);
+        if (!result.unresolved_used_variables.empty()) {
+            // TODO: error: unresolved variables
+        }
     }
 
     for (const auto& file : subfiles) {
@@ -130,11 +440,11 @@ void File::process_rest() { // NOLINT(misc-no-recursion)
     }
 }
 
-const Rule* File::find_rule(const std::string& name) const {
+const Pool* File::find_pool(std::string_view name) const {
     for (auto file = this; file; file = file->next_file()) {
-        const auto& it = file->rules.find(name);
+        const auto& it = file->pools.find(name);
 
-        if (it != rules.end()) {
+        if (it != file->pools.end()) {
             return &it->second;
         }
     }
@@ -142,54 +452,101 @@ const Rule* File::find_rule(const std::string& name) const {
     return nullptr;
 }
 
-const Variable* File::find_variable(const std::string& name) const {
+bool File::is_valid_pool(std::string_view name) const {
+    // Empty selects the default pool; references to variables are expanded by ninja and can't be checked.
+    return name.empty() || name == Pool::console || name.find('$') != std::string_view::npos || find_pool(name);
+}
+
+const Rule* File::find_rule(std::string_view name) const {
     for (auto file = this; file; file = file->next_file()) {
-        const auto& it = file->bindings.find(name);
+        const auto& it = file->rules.find(name);
 
-        if (it != file->bindings.end()) {
-            return it->second.get();
+        if (it != file->rules.end()) {
+            return &it->second;
         }
     }
 
     return nullptr;
 }
 
+const Variable* File::find_variable(std::string_view name) const {
+    for (auto file = this; file; file = file->next_file()) {
+        if (const auto variable = file->bindings.find(name)) {
+            return variable;
+        }
+    }
+
+    return host_variable(name);
+}
+
+Variable* File::host_variable(std::string_view name) const {
+    if (const auto variable = host_bindings.find(name)) {
+        return variable;
+    }
+
+    const auto value = Host::variable(name);
+    if (!value) {
+        return nullptr;
+    }
+    host_variables[std::string(name)] = *value;
+    host_bindings.add(std::unique_ptr<Variable>(new TextVariable{ std::string(name), Text{ *value, true } }));
+    return host_bindings.find(name);
+}
+
 void File::create_output() const { // NOLINT(misc-no-recursion)
     std::filesystem::create_directories(build_directory);
 
-    {
-        auto stream = std::ofstream(build_filename);
+    if (!up_to_date) {
+        auto output = OutputBuffer{};
 
-        if (stream.fail()) {
-            throw Exception("can't create output '{}'", build_filename.string());
-        }
+        output << "# This file is automatically created by fast-ninja from " << source_filename.generic_string() << '\n';
+        output << "# Do not edit.\n";
 
-        stream << "# This file is automatically created by fast-ninja from " << source_filename.generic_string() << std::endl;
-        stream << "# Do not edit." << std::endl << std::endl;
+        auto variables = OutputBuffer{};
+        const auto& referenced_variables = top_file()->referenced_variables;
+        bindings.print(variables, "", referenced_variables);
+        host_bindings.print(variables, "", referenced_variables);
+        if (!variables.empty()) {
+            output << '\n' << variables.string();
+        }
 
-        if (!bindings.empty()) {
-            bindings.print(stream, "");
+        for (auto& pool : std::views::values(pools)) {
+            pool.print(output);
         }
 
-        for (auto& rule : std::views::values(rules)) {
-            rule.print(stream);
+        for (const auto& [name, rule] : rules) {
+            if (top_file()->referenced_rules.contains(name)) {
+                rule.print(output);
+            }
         }
 
         for (auto& build : builds) {
-            build.print(stream);
+            build.print(output);
+        }
+
+        if (is_top()) {
+            print_directory_targets(output);
         }
 
         if (!defaults.empty()) {
-            stream << std::endl;
-            stream << "default " << defaults << std::endl;
+            output << "\ndefault " << defaults << '\n';
         }
 
         if (!subninjas.empty()) {
-            stream << std::endl;
+            output << '\n';
             for (auto& subninja : subninjas) {
-                stream << "subninja " << (build_directory / replace_extension(subninja, "ninja")).lexically_normal().generic_string() << std::endl;
+                output << "subninja " << (build_directory / replace_extension(subninja, "ninja")).lexically_normal().generic_string() << '\n';
             }
         }
+
+        output.write_if_changed(build_filename);
+
+        if (top_file()->options.index) {
+            write_index();
+        }
+        if (top_file()->options.locations) {
+            write_locations();
+        }
     }
 
     for (auto& subfile : subfiles) {
@@ -197,16 +554,81 @@ void File::create_output() const { // NOLINT(misc-no-recursion)
     }
 
     if (built_files_list) {
-        auto files = std::vector(outputs.begin(), outputs.end());
-        std::ranges::sort(files);
-        // TODO: exclude subninja files
-        auto stream = std::ofstream(built_files_list->full_name());
-        for (const auto& file : files) {
-            stream << file << std::endl;
+        update_built_files_list();
+    }
+
+    if (is_top()) {
+        auto state = RegenerationState{};
+        state.set_arguments(options.arguments());
+        collect_state(state);
+        state.write(state_filename());
+        state.write_depfile(RegenerationState::depfile_filename(build_directory));
+    }
+}
+
+void File::print_directory_targets(OutputBuffer& output) const {
+    auto directories = std::map<std::filesystem::path, PathSet>{};
+    collect_directory_outputs(directories);
+    directories.erase(build_directory);
+
+    // Targets defined in the sources take precedence; defined dir/all targets already include the directories below.
+    auto defined_targets = std::vector<Filename>{};
+    collect_all_outputs(defined_targets);
+    auto defined = PathSet{};
+    for (const auto& target : defined_targets) {
+        defined.insert(target.full_name().generic_string());
+    }
+
+    auto subdirectories = nearest_subdirectories(directories);
+
+    for (const auto& [directory, directory_outputs] : directories) {
+        const auto all_local = (directory / "all-local").generic_string();
+        const auto all = (directory / "all").generic_string();
+        if (!defined.contains(std::string_view(all_local))) {
+            output << "\nbuild ";
+            output.append_escaped(all_local);
+            output << " : phony";
+            for (const auto& file : directory_outputs.paths()) {
+                output << ' ';
+                output.append_escaped(std::filesystem::path(file).generic_string());
+            }
+            output << '\n';
+        }
+        if (!defined.contains(std::string_view(all))) {
+            output << "\nbuild ";
+            output.append_escaped(all);
+            output << " : phony ";
+            output.append_escaped(all_local);
+            for (const auto& subdirectory : subdirectories[directory]) {
+                output << ' ';
+                output.append_escaped((subdirectory / "all").generic_string());
+            }
+            output << '\n';
         }
     }
 }
 
+void File::collect_directory_outputs(std::map<std::filesystem::path, PathSet>& directories) const { // NOLINT(misc-no-recursion)
+    auto& directory_outputs = directories[build_directory];
+    for (const auto& build : builds) {
+        build.collect_output_files(directory_outputs);
+    }
+
+    for (const auto& file : subfiles) {
+        file->collect_directory_outputs(directories);
+    }
+}
+
+void File::collect_all_outputs(std::vector<Filename>& collector) const { // NOLINT(misc-no-recursion)
+    for (const auto& build : builds) {
+        build.collect_outputs(collector);
+    }
+
+    for (const auto& file : subfiles) {
+        file->collect_all_outputs(collector);
+    }
+}
+
 void File::parse(const std::filesystem::path& filename) {
     auto tokenizers = std::vector<Tokenizer>{};
     tokenizers.emplace_back(filename);
@@ -218,6 +640,7 @@ void File::parse(const std::filesystem::path& filename) {
 
         switch (token.type) {
             case Tokenizer::TokenType::END:
+                source_hashes[tokenizer.file_name()] = tokenizer.content_hash();
                 tokenizers.pop_back();
                 break;
 
@@ -226,7 +649,7 @@ void File::parse(const std::filesystem::path& filename) {
                 break;
 
             case Tokenizer::TokenType::BUILD:
-                parse_build(tokenizer);
+                parse_build(tokenizer, token.location);
                 break;
 
             case Tokenizer::TokenType::BUILT_FILES:
@@ -252,16 +675,25 @@ void File::parse(const std::filesystem::path& filename) {
                 break;
 
             case Tokenizer::TokenType::RULE:
-                parse_rule(tokenizer);
+                parse_rule(tokenizer, token.location);
                 break;
 
             case Tokenizer::TokenType::SUBNINJA:
                 parse_subninja(tokenizer);
                 break;
 
-            case Tokenizer::TokenType::WORD:
-                parse_assignment(tokenizer, token.value);
+            case Tokenizer::TokenType::WORD: {
+                // batch isn't reserved, so it can still be used as a variable name.
+                const auto next = tokenizer.next(Tokenizer::Skip::SPACE);
+                tokenizer.unget(next);
+                if (token.value == "batch" && next.type != Tokenizer::TokenType::ASSIGN && next.type != Tokenizer::TokenType::ASSIGN_LIST) {
+                    parse_batch(tokenizer, token.location);
+                }
+                else {
+                    parse_assignment(tokenizer, token.value);
+                }
                 break;
+            }
 
             case Tokenizer::TokenType::ASSIGN:
             case Tokenizer::TokenType::ASSIGN_LIST:
@@ -284,10 +716,10 @@ void File::parse_assignment(Tokenizer& tokenizer, const std::string& variable_na
     const auto token = tokenizer.next(Tokenizer::Skip::SPACE);
 
     if (token.type == Tokenizer::TokenType::ASSIGN) {
-        bindings.add(std::shared_ptr<Variable>(new TextVariable(variable_name, tokenizer)));
+        bindings.add(std::unique_ptr<Variable>(new TextVariable(variable_name, tokenizer)));
     }
     else if (token.type == Tokenizer::TokenType::ASSIGN_LIST) {
-        bindings.add(std::shared_ptr<Variable>(new FilenameVariable(variable_name, tokenizer)));
+        bindings.add(std::unique_ptr<Variable>(new FilenameVariable(variable_name, tokenizer)));
     }
     else {
         DiagnosticOutput::global.error(token.location, "invalid assignment");
@@ -295,7 +727,9 @@ void File::parse_assignment(Tokenizer& tokenizer, const std::string& variable_na
     }
 }
 
-void File::parse_build(Tokenizer& tokenizer) { builds.emplace_back(this, tokenizer); }
+void File::parse_batch(Tokenizer& tokenizer, const Location& location) { batches.emplace_back(tokenizer, location); }
+
+void File::parse_build(Tokenizer& tokenizer, const Location& location) { builds.emplace_back(this, tokenizer, location); }
 
 void File::parse_built_files_list(Tokenizer& tokenizer) {
     if (!is_top()) {
@@ -322,17 +756,21 @@ void File::parse_pool(Tokenizer& tokenizer) {
         DiagnosticOutput::global.error(token.location, "name expected");
         throw Exception();
     }
-    pools[token.string()] = Pool(token.string(), tokenizer);
+    if (pools.contains(token.value)) {
+        DiagnosticOutput::global.error(token.location, "duplicate pool '{}'", token.value);
+        throw Exception();
+    }
+    pools.insert_or_assign(token.value, Pool(token.value, token.location, tokenizer));
 }
 
-void File::parse_rule(Tokenizer& tokenizer) {
+void File::parse_rule(Tokenizer& tokenizer, const Location& location) {
     tokenizer.skip_space();
     const auto token = tokenizer.next();
     if (token.type != Tokenizer::TokenType::WORD) {
         DiagnosticOutput::global.error(token.location, "name expected");
         throw Exception();
     }
-    rules[token.string()] = Rule(this, token.string(), tokenizer);
+    rules.insert_or_assign(token.value, Rule(this, token.value, tokenizer, location));
 }
 
 void File::parse_subninja(Tokenizer& tokenizer) {
@@ -341,13 +779,113 @@ void File::parse_subninja(Tokenizer& tokenizer) {
     subninjas.emplace_back(text.string());
 }
 
-void File::add_generator_build(std::vector<Filename>& ninja_outputs, std::vector<Filename>& ninja_inputs) const { // NOLINT(misc-no-recursion)
+void File::add_generator_outputs(std::vector<Filename>& ninja_outputs) const { // NOLINT(misc-no-recursion)
     ninja_outputs.emplace_back(Location{}, Filename::Type::BUILD, build_filename.string());
-    ninja_inputs.insert(ninja_inputs.end(), includes.begin(), includes.end());
-    ninja_inputs.emplace_back(Location{}, Filename::Type::COMPLETE, source_filename.string());
+    for (const auto& file : sidecar_filenames()) {
+        ninja_outputs.emplace_back(Location{}, Filename::Type::BUILD, file.string());
+    }
     for (const auto& file : subfiles) {
-        file->add_generator_build(ninja_outputs, ninja_inputs);
+        file->add_generator_outputs(ninja_outputs);
+    }
+}
+
+void File::update_built_files_list() const {
+    const auto filename = built_files_list->full_name();
+
+    // Files created by fast-ninja itself are not built files.
+    auto generator_outputs = std::vector<Filename>{};
+    add_generator_outputs(generator_outputs);
+    auto excluded = PathSet{};
+    excluded.insert(filename.string());
+    for (const auto& output : generator_outputs) {
+        excluded.insert(output.full_name().string());
+    }
+
+    // Outputs are collected before pruning, so files of pruned builds are kept.
+    auto files = std::vector<std::string>{};
+    for (auto& file : outputs.paths()) {
+        if (!excluded.contains(std::string_view(file))) {
+            files.emplace_back(std::move(file));
+        }
+    }
+    std::ranges::sort(files);
+
+    auto previous_files = read_lines(filename);
+    if (!std::ranges::is_sorted(previous_files)) {
+        std::ranges::sort(previous_files);
+    }
+
+    auto output = OutputBuffer{};
+    for (const auto& file : files) {
+        output << file << '\n';
+    }
+    output.write_if_changed(filename);
+
+    if (options.clean_stale) {
+        auto stale_files = std::vector<std::string>{};
+        std::ranges::set_difference(previous_files, files, std::back_inserter(stale_files));
+        remove_files(stale_files);
+    }
+}
+
+void File::write_index() const {
+    auto index = QueryIndex{};
+
+    for (const auto& build : builds) {
+        auto outputs = std::vector<Filename>{};
+        auto inputs = std::vector<Filename>{};
+        build.collect_outputs(outputs);
+        build.collect_inputs(inputs);
+        for (const auto& output : outputs) {
+            index.add(QueryIndex::PRODUCERS, output.full_name().generic_string(), build.get_rule_name());
+        }
+        if (!outputs.empty()) {
+            for (const auto& input : inputs) {
+                index.add(QueryIndex::CONSUMERS, input.full_name().generic_string(), outputs.front().full_name().generic_string());
+            }
+        }
+    }
+
+    // Include inherited variables, so a lookup needs only this index.
+    auto seen = StringSet{};
+    for (auto file = this; file; file = file->next_file()) {
+        for (const auto& variable : file->bindings) {
+            if (seen.insert(variable->name).second) {
+                index.add(QueryIndex::VARIABLES, variable->name, variable->string());
+            }
+        }
+    }
+
+    index.write(QueryIndex::filename(build_filename));
+}
+
+void File::write_locations() const {
+    auto locations = BuildLocations{ source_filename };
+
+    for (const auto& build : builds) {
+        auto outputs = std::vector<Filename>{};
+        build.collect_outputs(outputs);
+        auto names = std::vector<std::string>{};
+        for (const auto& output : outputs) {
+            names.emplace_back(output.full_name().generic_string());
+        }
+        if (!names.empty()) {
+            locations.add(build.location.to_string(), build.get_rule_name(), std::move(names));
+        }
+    }
+
+    locations.write(BuildLocations::filename(build_filename));
+}
+
+std::vector<std::filesystem::path> File::sidecar_filenames() const {
+    auto filenames = std::vector<std::filesystem::path>{};
+    if (top_file()->options.index) {
+        filenames.emplace_back(QueryIndex::filename(build_filename));
+    }
+    if (top_file()->options.locations) {
+        filenames.emplace_back(BuildLocations::filename(build_filename));
     }
+    return filenames;
 }
 
 const File* File::next_file() const {
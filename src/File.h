@@ -36,8 +36,14 @@ IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <string>
 #include <unordered_set>
 
+#include "Batch.h"
 #include "Build.h"
+#include "FastNinjaUtil.h"
+#include "Hash.h"
+#include "Options.h"
+#include "PathSet.h"
 #include "Pool.h"
+#include "RegenerationState.h"
 #include "Rule.h"
 #include "Scope.h"
 #include "Variable.h"
@@ -50,12 +56,21 @@ class File : public Scope {
     File() = default;
     explicit File(const std::filesystem::path& filename, const std::filesystem::path& build_directory = ".", const File* next = {});
 
-    void process();
+    // If use_state is false, all files are processed, even those that are up to date.
+    void process(bool use_state = true);
 
-    [[nodiscard]] bool is_output(const std::filesystem::path& file) const { return outputs.contains(file.lexically_normal().string()); }
+    // file must be lexically normal.
+    [[nodiscard]] bool is_output(const std::filesystem::path& file) const { return outputs.contains(file); }
+    // Checks whether file exists and records the result, so changes can be detected on the next run.
+    [[nodiscard]] bool source_exists(const std::filesystem::path& file) const;
 
-    [[nodiscard]] const Rule* find_rule(const std::string& name) const;
-    [[nodiscard]] const Variable* find_variable(const std::string& name) const;
+    [[nodiscard]] const Pool* find_pool(std::string_view name) const;
+    [[nodiscard]] const Rule* find_rule(std::string_view name) const;
+    // Checks that name, the value of a pool binding, refers to a pool visible in this file.
+    [[nodiscard]] bool is_valid_pool(std::string_view name) const;
+    [[nodiscard]] const Variable* find_variable(std::string_view name) const;
+    // Returns the built-in host variable name, defining it in this file on first use. The value is recorded, so a change on the host triggers regeneration.
+    [[nodiscard]] Variable* host_variable(std::string_view name) const;
 
     void create_output() const;
 
@@ -63,37 +78,86 @@ class File : public Scope {
 
     [[nodiscard]] const File* top_file() const { return top()->as_file(); }
 
+    [[nodiscard]] const std::vector<Build>& get_builds() const { return builds; }
+    [[nodiscard]] const std::vector<std::unique_ptr<File>>& get_subfiles() const { return subfiles; }
+
     std::filesystem::path source_directory;
     std::filesystem::path build_directory;
+    Options options;
 
   private:
     void parse(const std::filesystem::path& filename);
     void parse_assignment(Tokenizer& tokenizer, const std::string& variable_name);
-    void parse_build(Tokenizer& tokenizer);
+    void parse_batch(Tokenizer& tokenizer, const Location& location);
+    void parse_build(Tokenizer& tokenizer, const Location& location);
     void parse_built_files_list(Tokenizer& tokenizer);
     void parse_default(Tokenizer& tokenizer);
     void parse_pool(Tokenizer& tokenizer);
-    void parse_rule(Tokenizer& tokenizer);
+    void parse_rule(Tokenizer& tokenizer, const Location& location);
     void parse_subninja(Tokenizer& tokenizer);
 
+    void check_pool_names(StringMap<const Pool*>& names) const;
+    // Removes builds not needed for the defaults, the roots given in options, or regenerating, and rules no longer used.
+    void prune();
+    void collect_rule_names(StringSet& names) const;
+    // Adds the variables referenced by the rules named in rule_names.
+    void collect_variable_references(const StringSet& rule_names, StringSet& names) const;
+    void collect_defaults(std::vector<std::string>& roots) const;
+    void collect_used_rules(std::unordered_set<const Rule*>& used_rules) const;
+    void remove_builds(const std::unordered_set<const Build*>& needed);
+    void remove_rules(const std::unordered_set<const Rule*>& used_rules);
     void process_bindings();
+    // Adds the builds of all batches, which needs resolved bindings.
+    void expand_batches();
     void process_output();
     void process_rest();
+    // Adds the all targets of the directories below to dir/all targets defined in the sources.
+    void add_subdirectory_targets();
+    void add_subdirectory_dependencies(const std::map<std::filesystem::path, std::vector<std::filesystem::path>>& subdirectories);
+
+    // Prints phony targets dir/all-local for the outputs of the builds in each subninja directory, and dir/all for those of the directory and all directories below it.
+    void print_directory_targets(OutputBuffer& output) const;
+    void collect_directory_outputs(std::map<std::filesystem::path, PathSet>& directories) const;
+    // Includes outputs of phony builds.
+    void collect_all_outputs(std::vector<Filename>& collector) const;
+
+    void add_generator_outputs(std::vector<Filename>& ninja_outputs) const;
+    void update_built_files_list() const;
+    void write_index() const;
+    void write_locations() const;
 
-    void add_generator_build(std::vector<Filename>& ninja_outputs, std::vector<Filename>& ninja_inputs) const;
+    void check_up_to_date(const RegenerationState& state, Hash context, uint64_t tree_hash);
+    void collect_state(RegenerationState& state) const;
+
+    // Files written next to the ninja file, depending on options.
+    [[nodiscard]] std::vector<std::filesystem::path> sidecar_filenames() const;
+    [[nodiscard]] std::filesystem::path state_filename() const { return RegenerationState::filename(build_directory); }
 
     std::filesystem::path source_filename;
     std::filesystem::path build_filename;
 
-    std::unordered_set<std::string> outputs;
+    PathSet outputs;
     std::set<Filename> includes;
-    std::map<std::string, Rule> rules;
-    std::map<std::string, Pool> pools;
+    // Contents of the file and its includes as they were parsed.
+    std::map<std::filesystem::path, uint64_t> source_hashes;
+    std::map<std::string, Rule, std::less<>> rules;
+    std::map<std::string, Pool, std::less<>> pools;
+    std::vector<Batch> batches;
     std::vector<Build> builds;
     std::optional<Filename> built_files_list;
     FilenameList defaults{ true };
     std::vector<std::filesystem::path> subninjas;
     std::vector<std::unique_ptr<File>> subfiles;
+
+    // Only set in the top file.
+    StringSet referenced_rules;
+    StringSet referenced_variables;
+
+    uint64_t fingerprint{};
+    bool up_to_date{ false };
+    mutable std::map<std::filesystem::path, bool> existence_checks;
+    mutable Bindings host_bindings;
+    mutable std::map<std::string, std::string> host_variables;
 };
 
 #endif // FILE_H
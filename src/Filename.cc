@@ -47,7 +47,7 @@ void Filename::resolve(const ResolveContext& context) {
         if (context.scope.is_output_file((file->build_directory / name).lexically_normal())) {
             type = Type::BUILD;
         }
-        else if (std::filesystem::exists(file->source_directory / name)) {
+        else if (file->source_exists(file->source_directory / name)) {
             type = Type::SOURCE;
         }
     }
@@ -67,7 +67,7 @@ void Filename::resolve(const ResolveContext& context) {
             if (prefix.empty()) {
                 prefix = file->source_directory;
             }
-            if (!std::filesystem::exists(full_name())) {
+            if (!file->source_exists(full_name())) {
                 DiagnosticOutput::global.error(location, "source file '{}' does not exist", full_name().string());
                 throw Exception();
             }
@@ -98,7 +98,7 @@ bool Filename::operator<(const Filename& other) const {
     return name < other.name;
 }
 
-std::ostream& operator<<(std::ostream& stream, const Filename& file_name) {
-    stream << dollar_escape(file_name.full_name().generic_string());
-    return stream;
+OutputBuffer& operator<<(OutputBuffer& output, const Filename& file_name) {
+    output.append_escaped(file_name.full_name().generic_string());
+    return output;
 }
@@ -32,6 +32,7 @@ IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <filesystem>
 
+#include "OutputBuffer.h"
 #include "ResolveContext.h"
 
 class Scope;
@@ -61,6 +62,6 @@ class Filename {
     Location location;
 };
 
-std::ostream& operator<<(std::ostream& stream, const Filename& file_name);
+OutputBuffer& operator<<(OutputBuffer& output, const Filename& file_name);
 
 #endif // FILENAME_H
@@ -93,16 +93,16 @@ void FilenameList::resolve(const ResolveContext& context) {
     }
 }
 
-void FilenameList::serialize(std::ostream& stream) const {
+void FilenameList::serialize(OutputBuffer& output) const {
     auto first = true;
     for (auto& filename : filenames) {
         if (first) {
             first = false;
         }
         else {
-            stream << " ";
+            output << ' ';
         }
-        stream << filename;
+        output << filename;
     }
 }
 
@@ -122,12 +122,12 @@ std::string FilenameList::string() const {
     return str;
 }
 
-std::ostream& operator<<(std::ostream& stream, const FilenameList& filename_list) {
-    filename_list.serialize(stream);
-    return stream;
+OutputBuffer& operator<<(OutputBuffer& output, const FilenameList& filename_list) {
+    filename_list.serialize(output);
+    return output;
 }
 
-void FilenameList::collect_output_files(std::unordered_set<std::string>& output_files) const {
+void FilenameList::collect_output_files(PathSet& output_files) const {
     for (auto& filename : filenames) {
         if (filename.type == Filename::Type::BUILD) {
             output_files.insert(filename.full_name().string());
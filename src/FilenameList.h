@@ -34,6 +34,7 @@ IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "Filename.h"
 #include "FilenameWord.h"
+#include "PathSet.h"
 
 class FilenameList {
   public:
@@ -53,12 +54,15 @@ class FilenameList {
 
     [[nodiscard]] bool is_resolved() const { return resolved; }
 
-    void serialize(std::ostream& stream) const;
+    void serialize(OutputBuffer& output) const;
     [[nodiscard]] std::string string() const;
 
     [[nodiscard]] bool contains_unknown_file() const { return false; } // TODO
 
-    void collect_output_files(std::unordered_set<std::string>& output_files) const;
+    void collect_output_files(PathSet& output_files) const;
+
+    // filename must be resolved.
+    void add(Filename filename) { filenames.emplace_back(std::move(filename)); }
 
     void collect_filenames(std::vector<Filename>& collector) const { collector.insert(collector.end(), filenames.begin(), filenames.end()); }
 
@@ -69,6 +73,6 @@ class FilenameList {
     bool resolved{ false };
 };
 
-std::ostream& operator<<(std::ostream& stream, const FilenameList& filename_list);
+OutputBuffer& operator<<(OutputBuffer& output, const FilenameList& filename_list);
 
 #endif // FILENAMELIST_H
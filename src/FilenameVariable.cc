@@ -49,4 +49,4 @@ FilenameVariable::FilenameVariable(std::string name, Tokenizer& tokenizer) : Var
     }
 }
 
-void FilenameVariable::print_definition(std::ostream& stream) const { stream << name << " = " << value << std::endl; }
+void FilenameVariable::print_definition(OutputBuffer& output) const { output << name << " = " << value << '\n'; }
@@ -44,12 +44,17 @@ class FilenameVariable : public Variable {
 
     void resolve(const ResolveContext& context) override { value.resolve(context); }
 
-    void print_definition(std::ostream& stream) const override;
+    void print_definition(OutputBuffer& output) const override;
 
     [[nodiscard]] std::string string() const override { return value.string(); }
 
+    [[nodiscard]] std::unique_ptr<Variable> clone() const override { return std::make_unique<FilenameVariable>(*this); }
+
     [[nodiscard]] bool contains_unknown_file() const override { return value.contains_unknown_file(); }
 
+    // File names are always expanded.
+    void collect_variable_references(StringSet& /*names*/) const override {}
+
     void collect_filenames(std::vector<Filename>& collector) const { return value.collect_filenames(collector); }
 
     bool is_resolved() const override { return value.is_resolved(); }
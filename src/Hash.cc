@@ -0,0 +1,120 @@
+/*
+Copyright (C) Dieter Baron
+
+The authors can be contacted at <fast-ninja@tpau.group>
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+
+2. The names of the authors may not be used to endorse or promote
+  products derived from this software without specific prior
+  written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS
+OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "Hash.h"
+
+#include <charconv>
+
+#include "MappedFile.h"
+
+namespace {
+constexpr uint64_t multiplier = 0xc6a4a7935bd1e995ULL;
+constexpr int shift = 47;
+
+uint64_t load_little_endian(const char* data) {
+    uint64_t value = 0;
+    for (auto i = 7; i >= 0; i--) {
+        value = (value << 8) | static_cast<unsigned char>(data[i]);
+    }
+    return value;
+}
+} // namespace
+
+// MurmurHash64A, processing eight bytes at a time.
+uint64_t Hash::hash(std::string_view data, uint64_t seed) {
+    auto h = seed ^ (data.size() * multiplier);
+
+    while (data.size() >= 8) {
+        auto k = load_little_endian(data.data());
+        k *= multiplier;
+        k ^= k >> shift;
+        k *= multiplier;
+
+        h ^= k;
+        h *= multiplier;
+        data.remove_prefix(8);
+    }
+
+    if (!data.empty()) {
+        for (auto i = data.size(); i > 0; i--) {
+            h ^= static_cast<uint64_t>(static_cast<unsigned char>(data[i - 1])) << (8 * (i - 1));
+        }
+        h *= multiplier;
+    }
+
+    h ^= h >> shift;
+    h *= multiplier;
+    h ^= h >> shift;
+
+    return h;
+}
+
+Hash& Hash::update(std::string_view data) {
+    state = hash(data, state);
+    return *this;
+}
+
+Hash& Hash::update(uint64_t value) {
+    char bytes[8];
+    for (auto& byte : bytes) {
+        byte = static_cast<char>(value & 0xff);
+        value >>= 8;
+    }
+    return update(std::string_view(bytes, sizeof(bytes)));
+}
+
+bool Hash::update_file(const std::filesystem::path& filename) {
+    const auto file = MappedFile{ filename };
+    if (!file.is_open()) {
+        return false;
+    }
+
+    update(file.data());
+    return true;
+}
+
+std::optional<uint64_t> Hash::parse(std::string_view str) {
+    uint64_t value;
+    const auto end = str.data() + str.size();
+    const auto result = std::from_chars(str.data(), end, value, 16);
+    if (result.ec != std::errc() || result.ptr != end) {
+        return {};
+    }
+    return value;
+}
+
+std::string Hash::string(uint64_t value) {
+    static const char* digits = "0123456789abcdef";
+    auto str = std::string(16, '0');
+    for (auto i = 15; i >= 0; i--) {
+        str[i] = digits[value & 0xf];
+        value >>= 4;
+    }
+    return str;
+}
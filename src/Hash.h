@@ -0,0 +1,59 @@
+/*
+Copyright (C) Dieter Baron
+
+The authors can be contacted at <fast-ninja@tpau.group>
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+
+2. The names of the authors may not be used to endorse or promote
+  products derived from this software without specific prior
+  written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS
+OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef HASH_H
+#define HASH_H
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+
+// Fast non-cryptographic 64 bit hash, used to detect changes between runs. The value does not depend on the platform.
+class Hash {
+  public:
+    Hash& update(std::string_view data);
+    Hash& update(uint64_t value);
+    // Returns false if the file can't be read.
+    bool update_file(const std::filesystem::path& filename);
+
+    [[nodiscard]] uint64_t value() const { return state; }
+
+    [[nodiscard]] std::string string() const { return string(state); }
+
+    [[nodiscard]] static uint64_t hash(std::string_view data, uint64_t seed);
+    [[nodiscard]] static std::optional<uint64_t> parse(std::string_view str);
+    [[nodiscard]] static std::string string(uint64_t value);
+
+  private:
+    uint64_t state{ 0 };
+};
+
+#endif // HASH_H
@@ -0,0 +1,150 @@
+/*
+Copyright (C) Dieter Baron
+
+The authors can be contacted at <fast-ninja@tpau.group>
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+
+2. The names of the authors may not be used to endorse or promote
+  products derived from this software without specific prior
+  written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS
+OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "config.h"
+
+#include "Host.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <thread>
+
+#include "FastNinjaUtil.h"
+
+#ifdef HAVE_SYSCONF
+#include <unistd.h>
+#endif
+
+namespace {
+// Reads the first line of a file, e.g. a cgroup control file.
+std::optional<std::string> read_line(const char* filename) {
+    auto stream = std::ifstream(filename);
+    auto line = std::string{};
+    if (!std::getline(stream, line)) {
+        return {};
+    }
+    return line;
+}
+
+uint64_t cpu_count() {
+#ifdef HAVE_SYSCONF
+    if (const auto count = sysconf(_SC_NPROCESSORS_ONLN); count > 0) {
+        return static_cast<uint64_t>(count);
+    }
+#endif
+    return std::max(std::thread::hardware_concurrency(), 1u);
+}
+
+std::optional<uint64_t> cgroup_cpu_limit() {
+    uint64_t quota;
+    uint64_t period;
+
+    if (const auto line = read_line("/sys/fs/cgroup/cpu.max")) {
+        // cgroup v2: "QUOTA PERIOD", where QUOTA is "max" if unlimited.
+        const auto space = line->find(' ');
+        if (space == std::string::npos) {
+            return {};
+        }
+        const auto parsed_quota = parse_number<uint64_t>(std::string_view(*line).substr(0, space));
+        const auto parsed_period = parse_number<uint64_t>(std::string_view(*line).substr(space + 1));
+        if (!parsed_quota || !parsed_period) {
+            return {};
+        }
+        quota = *parsed_quota;
+        period = *parsed_period;
+    }
+    else {
+        // cgroup v1, quota is -1 if unlimited.
+        const auto quota_line = read_line("/sys/fs/cgroup/cpu/cpu.cfs_quota_us");
+        const auto period_line = read_line("/sys/fs/cgroup/cpu/cpu.cfs_period_us");
+        if (!quota_line || !period_line) {
+            return {};
+        }
+        const auto parsed_quota = parse_number<uint64_t>(*quota_line);
+        const auto parsed_period = parse_number<uint64_t>(*period_line);
+        if (!parsed_quota || !parsed_period) {
+            return {};
+        }
+        quota = *parsed_quota;
+        period = *parsed_period;
+    }
+
+    if (period == 0) {
+        return {};
+    }
+    return std::max<uint64_t>((quota + period - 1) / period, 1);
+}
+
+std::optional<uint64_t> cgroup_memory_limit() {
+    for (const auto filename : { "/sys/fs/cgroup/memory.max", "/sys/fs/cgroup/memory/memory.limit_in_bytes" }) {
+        if (const auto line = read_line(filename)) {
+            // Unlimited is "max" for cgroup v2, a huge number for cgroup v1.
+            return parse_number<uint64_t>(*line);
+        }
+    }
+    return {};
+}
+
+std::map<std::string, std::string, std::less<>> compute_variables() {
+    auto variables = std::map<std::string, std::string, std::less<>>{};
+
+    const auto cpus = cpu_count();
+    variables["host_cpu_count"] = std::to_string(cpus);
+    variables["host_cpu_quota"] = std::to_string(std::min(cpus, cgroup_cpu_limit().value_or(cpus)));
+
+#ifdef HAVE_SYSCONF
+    const auto page_size = sysconf(_SC_PAGESIZE);
+    const auto pages = sysconf(_SC_PHYS_PAGES);
+    if (page_size > 0) {
+        variables["host_page_size"] = std::to_string(page_size);
+        if (pages > 0) {
+            auto memory = static_cast<uint64_t>(pages) * static_cast<uint64_t>(page_size);
+            if (const auto limit = cgroup_memory_limit()) {
+                memory = std::min(memory, *limit);
+            }
+            variables["host_memory"] = std::to_string(memory / (1024 * 1024));
+        }
+    }
+#endif
+
+    return variables;
+}
+} // namespace
+
+std::optional<std::string> Host::variable(std::string_view name) {
+    static const auto variables = compute_variables();
+
+    const auto it = variables.find(name);
+    if (it == variables.end()) {
+        return {};
+    }
+    return it->second;
+}
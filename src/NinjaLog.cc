@@ -0,0 +1,91 @@
+/*
+Copyright (C) Dieter Baron
+
+The authors can be contacted at <fast-ninja@tpau.group>
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+
+2. The names of the authors may not be used to endorse or promote
+  products derived from this software without specific prior
+  written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS
+OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "NinjaLog.h"
+
+#include <fstream>
+#include <string>
+
+#include <tpau-cpp-kernal/Exception.h>
+
+#include "FastNinjaUtil.h"
+
+using namespace tpau::cpp_kernal;
+
+/*
+ The log starts with a line "# ninja log vN", followed by lines of the form
+
+ START-MS TAB END-MS TAB MTIME TAB OUTPUT TAB COMMAND-HASH
+
+ Later lines for the same output replace earlier ones.
+ */
+NinjaLog::NinjaLog(const std::filesystem::path& filename) {
+    auto stream = std::ifstream(filename);
+    if (!stream) {
+        throw Exception("can't open '{}'", filename.string());
+    }
+
+    auto line = std::string{};
+    if (!std::getline(stream, line) || !line.starts_with("# ninja log v")) {
+        throw Exception("'{}' is not a ninja log", filename.string());
+    }
+
+    while (std::getline(stream, line)) {
+        auto fields = std::string_view(line);
+        std::string_view columns[4];
+        auto valid = true;
+        for (auto& column : columns) {
+            const auto tab = fields.find('\t');
+            if (tab == std::string_view::npos) {
+                valid = false;
+                break;
+            }
+            column = fields.substr(0, tab);
+            fields.remove_prefix(tab + 1);
+        }
+        if (!valid) {
+            continue;
+        }
+
+        const auto start = parse_number<uint64_t>(columns[0]);
+        const auto end = parse_number<uint64_t>(columns[1]);
+        if (!start || !end || *end < *start) {
+            continue;
+        }
+        durations.insert_or_assign(std::string(columns[3]), *end - *start);
+    }
+}
+
+std::optional<uint64_t> NinjaLog::duration(std::string_view output) const {
+    const auto it = durations.find(output);
+    if (it == durations.end()) {
+        return {};
+    }
+    return it->second;
+}
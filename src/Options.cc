@@ -0,0 +1,61 @@
+/*
+Copyright (C) Dieter Baron
+
+The authors can be contacted at <fast-ninja@tpau.group>
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+
+2. The names of the authors may not be used to endorse or promote
+  products derived from this software without specific prior
+  written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS
+OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "Options.h"
+
+std::vector<std::string> Options::arguments() const {
+    auto arguments = std::vector<std::string>{};
+
+    if (!cache_directory.empty()) {
+        arguments.emplace_back("--cache");
+        arguments.emplace_back(cache_directory);
+        if (cache_size != default_cache_size) {
+            arguments.emplace_back("--cache-size");
+            arguments.emplace_back(std::to_string(cache_size));
+        }
+    }
+    if (clean_stale) {
+        arguments.emplace_back("--clean-stale");
+    }
+    if (index) {
+        arguments.emplace_back("--index");
+    }
+    if (locations) {
+        arguments.emplace_back("--locations");
+    }
+    if (prune) {
+        arguments.emplace_back("--prune");
+    }
+    for (const auto& root : roots) {
+        arguments.emplace_back("--root");
+        arguments.emplace_back(root);
+    }
+
+    return arguments;
+}
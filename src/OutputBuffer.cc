@@ -0,0 +1,97 @@
+/*
+Copyright (C) Dieter Baron
+
+The authors can be contacted at <fast-ninja@tpau.group>
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+
+2. The names of the authors may not be used to endorse or promote
+  products derived from this software without specific prior
+  written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS
+OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "OutputBuffer.h"
+
+#include <fstream>
+
+#include <tpau-cpp-kernal/Exception.h>
+
+using namespace tpau::cpp_kernal;
+
+void OutputBuffer::append_escaped(std::string_view str) {
+    while (true) {
+        const auto index = str.find_first_of(" $:\n");
+        if (index == std::string_view::npos) {
+            data.append(str);
+            return;
+        }
+        data.append(str.substr(0, index));
+        data += '$';
+        data += str[index];
+        str.remove_prefix(index + 1);
+    }
+}
+
+bool OutputBuffer::write_if_changed(const std::filesystem::path& filename) const {
+    if (is_unchanged(filename)) {
+        return false;
+    }
+
+    // Write to a temporary file and rename it, so readers never see a partially written file.
+    auto temporary_filename = filename;
+    temporary_filename += ".tmp";
+
+    {
+        auto stream = std::ofstream(temporary_filename, std::ios::binary);
+
+        if (stream.fail()) {
+            throw Exception("can't create output '{}'", temporary_filename.string());
+        }
+
+        stream.write(data.data(), static_cast<std::streamsize>(data.size()));
+        stream.close();
+
+        if (stream.fail()) {
+            std::error_code error;
+            std::filesystem::remove(temporary_filename, error);
+            throw Exception("can't write output '{}'", temporary_filename.string());
+        }
+    }
+
+    std::filesystem::rename(temporary_filename, filename);
+    return true;
+}
+
+bool OutputBuffer::is_unchanged(const std::filesystem::path& filename) const {
+    std::error_code error;
+    const auto size = std::filesystem::file_size(filename, error);
+    if (error || size != data.size()) {
+        return false;
+    }
+
+    auto stream = std::ifstream(filename, std::ios::binary);
+    if (stream.fail()) {
+        return false;
+    }
+
+    auto existing = std::string(data.size(), '\0');
+    stream.read(existing.data(), static_cast<std::streamsize>(existing.size()));
+    return stream.gcount() == static_cast<std::streamsize>(existing.size()) && existing == data;
+}
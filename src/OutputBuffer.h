@@ -0,0 +1,72 @@
+/*
+Copyright (C) Dieter Baron
+
+The authors can be contacted at <fast-ninja@tpau.group>
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+
+2. The names of the authors may not be used to endorse or promote
+  products derived from this software without specific prior
+  written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS
+OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef OUTPUT_BUFFER_H
+#define OUTPUT_BUFFER_H
+
+#include <filesystem>
+#include <string>
+#include <string_view>
+
+/*
+ Append-only buffer that generated files are rendered into.
+ The finished contents are written to disk with a single write, and only if they differ from what is already there.
+ */
+class OutputBuffer {
+  public:
+    OutputBuffer& operator<<(std::string_view str) {
+        data.append(str);
+        return *this;
+    }
+
+    OutputBuffer& operator<<(char c) {
+        data += c;
+        return *this;
+    }
+
+    void append_escaped(std::string_view str);
+
+    [[nodiscard]] bool empty() const { return data.empty(); }
+
+    [[nodiscard]] size_t size() const { return data.size(); }
+
+    [[nodiscard]] const std::string& string() const { return data; }
+
+    [[nodiscard]] std::string release() { return std::move(data); }
+
+    // Returns true if the file was written.
+    bool write_if_changed(const std::filesystem::path& filename) const;
+
+  private:
+    [[nodiscard]] bool is_unchanged(const std::filesystem::path& filename) const;
+
+    std::string data;
+};
+
+#endif // OUTPUT_BUFFER_H
@@ -0,0 +1,122 @@
+/*
+Copyright (C) Dieter Baron
+
+The authors can be contacted at <fast-ninja@tpau.group>
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+
+2. The names of the authors may not be used to endorse or promote
+  products derived from this software without specific prior
+  written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS
+OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "PathSet.h"
+
+#include <type_traits>
+
+namespace {
+bool is_separator(char c) { return c == '/' || c == static_cast<char>(std::filesystem::path::preferred_separator); }
+
+// Returns the next path component, skipping empty and "." components. Returns an empty view at the end of the path.
+// The root directory of an absolute path is returned as its own component "/".
+std::string_view next_component(std::string_view& path, bool first) {
+    if (first && !path.empty() && is_separator(path[0])) {
+        path.remove_prefix(1);
+        return "/";
+    }
+    while (!path.empty()) {
+        size_t end = 0;
+        while (end < path.size() && !is_separator(path[end])) {
+            end += 1;
+        }
+        auto component = path.substr(0, end);
+        path.remove_prefix(end < path.size() ? end + 1 : end);
+        if (!component.empty() && component != ".") {
+            return component;
+        }
+    }
+    return {};
+}
+} // namespace
+
+void PathSet::insert(std::string_view path) {
+    auto node = &root;
+
+    for (auto component = next_component(path, true); !component.empty(); component = next_component(path, false)) {
+        auto it = node->children.find(component);
+        if (it == node->children.end()) {
+            it = node->children.emplace(std::string(component), std::make_unique<Node>()).first;
+        }
+        node = it->second.get();
+    }
+
+    if (!node->is_member) {
+        node->is_member = true;
+        count += 1;
+    }
+}
+
+bool PathSet::contains(std::string_view path) const {
+    auto node = &root;
+
+    for (auto component = next_component(path, true); !component.empty(); component = next_component(path, false)) {
+        const auto it = node->children.find(component);
+        if (it == node->children.end()) {
+            return false;
+        }
+        node = it->second.get();
+    }
+
+    return node->is_member;
+}
+
+bool PathSet::contains(const std::filesystem::path& path) const {
+    if constexpr (std::is_same_v<std::filesystem::path::value_type, char>) {
+        return contains(std::string_view(path.native()));
+    }
+    else {
+        return contains(std::string_view(path.string()));
+    }
+}
+
+std::vector<std::string> PathSet::paths() const {
+    auto result = std::vector<std::string>{};
+    auto prefix = std::string{};
+
+    result.reserve(count);
+    root.collect_paths(prefix, result);
+    return result;
+}
+
+void PathSet::Node::collect_paths(std::string& prefix, std::vector<std::string>& paths) const { // NOLINT(misc-no-recursion)
+    if (is_member) {
+        paths.emplace_back(prefix.empty() ? "." : prefix);
+    }
+
+    for (const auto& [name, child] : children) {
+        const auto length = prefix.size();
+        if (!prefix.empty() && prefix.back() != '/') {
+            prefix += '/';
+        }
+        prefix += name;
+        child->collect_paths(prefix, paths);
+        prefix.resize(length);
+    }
+}
@@ -0,0 +1,69 @@
+/*
+Copyright (C) Dieter Baron
+
+The authors can be contacted at <fast-ninja@tpau.group>
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+
+2. The names of the authors may not be used to endorse or promote
+  products derived from this software without specific prior
+  written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS
+OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef PATH_SET_H
+#define PATH_SET_H
+
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/*
+ Set of normalized paths, stored as a trie of path components.
+ Directories shared by many paths are stored only once, and lookups walk the components of the query in place without building any strings.
+ */
+class PathSet {
+  public:
+    void insert(std::string_view path);
+    [[nodiscard]] bool contains(std::string_view path) const;
+    [[nodiscard]] bool contains(const std::filesystem::path& path) const;
+
+    [[nodiscard]] bool empty() const { return count == 0; }
+
+    [[nodiscard]] size_t size() const { return count; }
+
+    [[nodiscard]] std::vector<std::string> paths() const;
+
+  private:
+    class Node {
+      public:
+        void collect_paths(std::string& prefix, std::vector<std::string>& paths) const;
+
+        std::map<std::string, std::unique_ptr<Node>, std::less<>> children;
+        bool is_member{ false };
+    };
+
+    Node root;
+    size_t count{};
+};
+
+#endif // PATH_SET_H
@@ -29,16 +29,27 @@ IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "Pool.h"
 
+#include <tpau-cpp-kernal/DiagnosticOutput.h>
+#include <tpau-cpp-kernal/Exception.h>
+
 #include "File.h"
 
-Pool::Pool(std::string name, Tokenizer& tokenizer) : name{ std::move(name) } {
+using namespace tpau::cpp_kernal;
+
+Pool::Pool(std::string name, Location location, Tokenizer& tokenizer) : location{ std::move(location) }, name{ std::move(name) } {
     tokenizer.expect(Tokenizer::TokenType::NEWLINE, Tokenizer::Skip::SPACE);
     bindings = Bindings{ tokenizer };
 }
 
-void Pool::process(const File& file) { bindings.resolve(file); }
+void Pool::process(const File& file) {
+    bindings.resolve(file);
+    if (!bindings.find("depth")) {
+        DiagnosticOutput::global.error(location, "pool '{}' has no depth", name);
+        throw Exception();
+    }
+}
 
-void Pool::print(std::ostream& stream) const {
-    stream << std::endl << "pool " << name << std::endl;
-    bindings.print(stream, "    ");
+void Pool::print(OutputBuffer& output) const {
+    output << "\npool " << name << '\n';
+    bindings.print(output, "    ");
 }
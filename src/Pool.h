@@ -31,6 +31,7 @@ IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define POOL_H
 
 #include <string>
+#include <string_view>
 
 #include "Bindings.h"
 #include "Variable.h"
@@ -40,10 +41,17 @@ class File;
 class Pool {
   public:
     Pool() = default;
-    Pool(std::string name, Tokenizer& tokenizer);
+    Pool(std::string name, Location location, Tokenizer& tokenizer);
+
+    [[nodiscard]] const std::string& get_name() const { return name; }
 
     void process(const File& file);
-    void print(std::ostream& stream) const;
+    void print(OutputBuffer& output) const;
+
+    // Name of the pool predefined by ninja.
+    static constexpr std::string_view console = "console";
+
+    Location location;
 
   private:
     std::string name;
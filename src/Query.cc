@@ -0,0 +1,131 @@
+/*
+Copyright (C) Dieter Baron
+
+The authors can be contacted at <fast-ninja@tpau.group>
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+
+2. The names of the authors may not be used to endorse or promote
+  products derived from this software without specific prior
+  written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS
+OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "Query.h"
+
+#include <filesystem>
+#include <vector>
+
+#include "File.h"
+#include "OutputBuffer.h"
+
+namespace {
+std::string normalize(std::string_view path) { return std::filesystem::path(path).lexically_normal().generic_string(); }
+
+void print_filenames(OutputBuffer& output, const std::vector<Filename>& filenames) {
+    for (const auto& filename : filenames) {
+        output << filename.full_name().generic_string() << '\n';
+    }
+}
+} // namespace
+
+Query::Query(const File& file) { add(file); }
+
+void Query::add(const File& file) { // NOLINT(misc-no-recursion)
+    directories[normalize(file.build_directory.generic_string())] = &file;
+
+    for (const auto& build : file.get_builds()) {
+        if (build.is_phony()) {
+            continue;
+        }
+        auto outputs = std::vector<Filename>{};
+        build.collect_outputs(outputs);
+        for (const auto& output : outputs) {
+            producers[output.full_name().generic_string()] = &build;
+        }
+    }
+
+    for (const auto& subfile : file.get_subfiles()) {
+        add(*subfile);
+    }
+}
+
+const Build* Query::find_producer(std::string_view file) const {
+    const auto it = producers.find(normalize(file));
+    return it == producers.end() ? nullptr : it->second;
+}
+
+std::string Query::answer(std::string_view request) const {
+    auto output = OutputBuffer{};
+
+    const auto space = request.find(' ');
+    if (space == std::string_view::npos) {
+        output << "error: missing argument\n";
+        return output.release();
+    }
+    const auto command = request.substr(0, space);
+    const auto argument = request.substr(space + 1);
+
+    if (command == "variable") {
+        const auto at = argument.find('@');
+        const auto name = argument.substr(0, at);
+        const auto directory = at == std::string_view::npos ? std::string{ "." } : normalize(argument.substr(at + 1));
+        const auto it = directories.find(directory);
+        if (it == directories.end()) {
+            output << "error: unknown directory '" << directory << "'\n";
+        }
+        else if (const auto variable = it->second->find_variable(name)) {
+            output << variable->string() << '\n';
+        }
+        else {
+            output << "error: unknown variable '" << name << "'\n";
+        }
+        return output.release();
+    }
+
+    if (command != "producer" && command != "outputs" && command != "inputs" && command != "location") {
+        output << "error: unknown request '" << command << "'\n";
+        return output.release();
+    }
+
+    const auto build = find_producer(argument);
+    if (!build) {
+        output << "error: no build creates '" << argument << "'\n";
+        return output.release();
+    }
+
+    if (command == "producer") {
+        output << build->get_rule_name() << '\n';
+    }
+    else if (command == "location") {
+        output << build->location.to_string() << '\n';
+    }
+    else {
+        auto filenames = std::vector<Filename>{};
+        if (command == "outputs") {
+            build->collect_outputs(filenames);
+        }
+        else {
+            build->collect_inputs(filenames);
+        }
+        print_filenames(output, filenames);
+    }
+
+    return output.release();
+}
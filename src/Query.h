@@ -0,0 +1,68 @@
+/*
+Copyright (C) Dieter Baron
+
+The authors can be contacted at <fast-ninja@tpau.group>
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+
+2. The names of the authors may not be used to endorse or promote
+  products derived from this software without specific prior
+  written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS
+OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef QUERY_H
+#define QUERY_H
+
+#include <string>
+#include <string_view>
+
+#include "FastNinjaUtil.h"
+
+class Build;
+class File;
+
+/*
+ Answers questions about a processed build tree. A request is a single line:
+
+ producer FILE          rule of the build that creates FILE
+ outputs FILE           all outputs of the build that creates FILE
+ inputs FILE            all inputs of the build that creates FILE
+ location FILE          source location of the build that creates FILE
+ variable NAME[@DIR]    value of variable NAME in the scope of the build directory DIR (default: top)
+
+ Files are given relative to the top build directory, as in the generated ninja files.
+ */
+class Query {
+  public:
+    explicit Query(const File& file);
+
+    // Each line of the answer ends in a newline. Errors are reported as a single line starting with "error: ".
+    [[nodiscard]] std::string answer(std::string_view request) const;
+
+  private:
+    void add(const File& file);
+
+    [[nodiscard]] const Build* find_producer(std::string_view file) const;
+
+    StringMap<const Build*> producers;
+    StringMap<const File*> directories;
+};
+
+#endif // QUERY_H
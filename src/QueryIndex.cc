@@ -0,0 +1,182 @@
+/*
+Copyright (C) Dieter Baron
+
+The authors can be contacted at <fast-ninja@tpau.group>
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+
+2. The names of the authors may not be used to endorse or promote
+  products derived from this software without specific prior
+  written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS
+OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "QueryIndex.h"
+
+#include <algorithm>
+
+#include <tpau-cpp-kernal/Util.h>
+
+#include "FastNinjaUtil.h"
+#include "OutputBuffer.h"
+
+using namespace tpau::cpp_kernal;
+
+namespace {
+constexpr std::string_view magic = "FNINDEX1";
+constexpr size_t record_size = 16;
+constexpr size_t header_size = magic.size() + QueryIndex::TABLE_COUNT * 8;
+
+void append_uint32(OutputBuffer& output, size_t value) {
+    for (auto i = 0; i < 4; i++) {
+        output << static_cast<char>(value & 0xff);
+        value >>= 8;
+    }
+}
+
+uint32_t load_uint32(std::string_view data, size_t offset) {
+    uint32_t value = 0;
+    for (auto i = 4; i > 0; i--) {
+        value = (value << 8) | static_cast<unsigned char>(data[offset + i - 1]);
+    }
+    return value;
+}
+} // namespace
+
+QueryIndex::QueryIndex(const std::filesystem::path& filename) : mapped_file{ std::make_unique<MappedFile>(filename) } {
+    const auto data = mapped_file->data();
+    if (data.size() < header_size || !data.starts_with(magic)) {
+        return;
+    }
+
+    for (size_t table = 0; table < TABLE_COUNT; table++) {
+        table_offsets[table] = load_uint32(data, magic.size() + table * 8);
+        table_sizes[table] = load_uint32(data, magic.size() + table * 8 + 4);
+        if (table_offsets[table] > data.size() || (data.size() - table_offsets[table]) / record_size < table_sizes[table]) {
+            return;
+        }
+        for (size_t index = 0; index < table_sizes[table]; index++) {
+            const auto offset = table_offsets[table] + index * record_size;
+            for (size_t field = 0; field < 4; field += 2) {
+                const auto string_offset = load_uint32(data, offset + field * 4);
+                const auto string_length = load_uint32(data, offset + field * 4 + 4);
+                if (string_offset > data.size() || data.size() - string_offset < string_length) {
+                    return;
+                }
+            }
+        }
+    }
+
+    valid = true;
+}
+
+std::filesystem::path QueryIndex::filename(const std::filesystem::path& ninja_file) { return replace_extension(ninja_file, "fast-ninja-index"); }
+
+void QueryIndex::write(const std::filesystem::path& filename) {
+    auto strings = OutputBuffer{};
+    auto string_offsets = StringMap<size_t>{};
+    auto offset_of = [&](const std::string& string) {
+        // Keys and values repeat a lot (e.g. rule names), store them only once.
+        const auto [it, inserted] = string_offsets.try_emplace(string, strings.size());
+        if (inserted) {
+            strings << string;
+        }
+        return it->second;
+    };
+
+    auto record_count = size_t{ 0 };
+    for (auto& table : records) {
+        std::ranges::sort(table);
+        table.erase(std::unique(table.begin(), table.end()), table.end());
+        record_count += table.size();
+    }
+    const auto strings_offset = header_size + record_count * record_size;
+
+    auto output = OutputBuffer{};
+    output << magic;
+    auto table_offset = header_size;
+    for (const auto& table : records) {
+        append_uint32(output, table_offset);
+        append_uint32(output, table.size());
+        table_offset += table.size() * record_size;
+    }
+    for (const auto& table : records) {
+        for (const auto& [key, value] : table) {
+            append_uint32(output, strings_offset + offset_of(key));
+            append_uint32(output, key.size());
+            append_uint32(output, strings_offset + offset_of(value));
+            append_uint32(output, value.size());
+        }
+    }
+    output << strings.string();
+
+    output.write_if_changed(filename);
+}
+
+QueryIndex::Record QueryIndex::record(Table table, size_t index) const {
+    const auto data = mapped_file->data();
+    const auto offset = table_offsets[table] + index * record_size;
+    return Record{ data.substr(load_uint32(data, offset), load_uint32(data, offset + 4)), data.substr(load_uint32(data, offset + 8), load_uint32(data, offset + 12)) };
+}
+
+size_t QueryIndex::lower_bound(Table table, std::string_view key) const {
+    auto low = size_t{ 0 };
+    auto high = size_t{ table_sizes[table] };
+    while (low < high) {
+        const auto middle = low + (high - low) / 2;
+        if (record(table, middle).key < key) {
+            low = middle + 1;
+        }
+        else {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+std::vector<std::string_view> QueryIndex::find(Table table, std::string_view key) const {
+    auto values = std::vector<std::string_view>{};
+    if (!is_valid()) {
+        return values;
+    }
+
+    for (auto index = lower_bound(table, key); index < table_sizes[table]; index++) {
+        const auto current = record(table, index);
+        if (current.key != key) {
+            break;
+        }
+        values.emplace_back(current.value);
+    }
+    return values;
+}
+
+std::vector<std::string_view> QueryIndex::keys(Table table) const {
+    auto keys = std::vector<std::string_view>{};
+    if (!is_valid()) {
+        return keys;
+    }
+
+    for (size_t index = 0; index < table_sizes[table]; index++) {
+        const auto key = record(table, index).key;
+        if (keys.empty() || keys.back() != key) {
+            keys.emplace_back(key);
+        }
+    }
+    return keys;
+}
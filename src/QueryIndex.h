@@ -0,0 +1,93 @@
+/*
+Copyright (C) Dieter Baron
+
+The authors can be contacted at <fast-ninja@tpau.group>
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+
+2. The names of the authors may not be used to endorse or promote
+  products derived from this software without specific prior
+  written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS
+OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef QUERY_INDEX_H
+#define QUERY_INDEX_H
+
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "MappedFile.h"
+
+/*
+ Index of the builds and variables of one generated ninja file, written next to it, so queries can be answered without parsing anything.
+ The file is designed to be used directly from memory: a header, followed by sorted tables of fixed size records that point into a string area.
+
+ header: "FNINDEX1", then offset and record count of each table (uint32 each)
+ record: key offset, key length, value offset, value length (uint32 each)
+
+ All numbers are little endian.
+ */
+class QueryIndex {
+  public:
+    enum Table {
+        PRODUCERS, // output -> rule
+        CONSUMERS, // input -> first output of the build using it
+        VARIABLES, // name -> value
+        TABLE_COUNT
+    };
+
+    QueryIndex() = default;
+    // Opens an index for reading. Check is_valid() before use.
+    explicit QueryIndex(const std::filesystem::path& filename);
+
+    void add(Table table, std::string key, std::string value) { records[table].emplace_back(std::move(key), std::move(value)); }
+    void write(const std::filesystem::path& filename);
+
+    [[nodiscard]] bool is_valid() const { return mapped_file && mapped_file->is_open() && valid; }
+
+    [[nodiscard]] std::vector<std::string_view> find(Table table, std::string_view key) const;
+    [[nodiscard]] std::vector<std::string_view> keys(Table table) const;
+
+    [[nodiscard]] static std::filesystem::path filename(const std::filesystem::path& ninja_file);
+
+  private:
+    class Record {
+      public:
+        std::string_view key;
+        std::string_view value;
+    };
+
+    [[nodiscard]] Record record(Table table, size_t index) const;
+    [[nodiscard]] size_t lower_bound(Table table, std::string_view key) const;
+
+    std::array<std::vector<std::pair<std::string, std::string>>, TABLE_COUNT> records;
+
+    std::unique_ptr<MappedFile> mapped_file;
+    std::array<uint32_t, TABLE_COUNT> table_offsets{};
+    std::array<uint32_t, TABLE_COUNT> table_sizes{};
+    bool valid{ false };
+};
+
+#endif // QUERY_INDEX_H
@@ -0,0 +1,177 @@
+/*
+Copyright (C) Dieter Baron
+
+The authors can be contacted at <fast-ninja@tpau.group>
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+
+2. The names of the authors may not be used to endorse or promote
+  products derived from this software without specific prior
+  written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS
+OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "config.h"
+
+#include "QueryServer.h"
+
+#include <tpau-cpp-kernal/DiagnosticOutput.h>
+#include <tpau-cpp-kernal/Exception.h>
+
+#include "FastNinjaUtil.h"
+#include "Query.h"
+
+#ifdef HAVE_SYS_UN_H
+#include <cerrno>
+#include <cstring>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+using namespace tpau::cpp_kernal;
+
+#ifdef HAVE_SYS_UN_H
+QueryServer::QueryServer(std::filesystem::path socket_path, std::function<std::unique_ptr<Query>()> load, std::function<bool()> is_current) : socket_path{ std::move(socket_path) }, load{ std::move(load) }, is_current{ std::move(is_current) }, query{ this->load() }, fd{ listen_on_socket(this->socket_path) } {}
+
+QueryServer::~QueryServer() {
+    for (const auto& client : clients) {
+        close(client.fd);
+    }
+    close(fd);
+    std::error_code error;
+    std::filesystem::remove(socket_path, error);
+}
+
+bool QueryServer::is_supported() { return true; }
+
+void QueryServer::run() {
+    auto poll_fds = std::vector<pollfd>{};
+
+    while (true) {
+        poll_fds.clear();
+        poll_fds.push_back(pollfd{ fd, POLLIN, 0 });
+        for (const auto& client : clients) {
+            poll_fds.push_back(pollfd{ client.fd, static_cast<short>(client.output.empty() ? POLLIN : POLLOUT), 0 });
+        }
+
+        if (poll(poll_fds.data(), poll_fds.size(), -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw Exception("can't wait for queries: {}", std::strerror(errno));
+        }
+
+        // Handle existing clients first, since accepting may invalidate the indices.
+        for (size_t i = clients.size(); i > 0; i--) {
+            auto& client = clients[i - 1];
+            const auto events = poll_fds[i].revents;
+            if (events == 0) {
+                continue;
+            }
+            const auto ok = client.output.empty() ? read_requests(client) : write_answers(client);
+            if (!ok || (!client.reading && client.output.empty())) {
+                close(client.fd);
+                clients.erase(clients.begin() + static_cast<std::ptrdiff_t>(i - 1));
+            }
+        }
+
+        if (poll_fds[0].revents & POLLIN) {
+            if (const auto client_fd = accept4(fd, nullptr, nullptr, SOCK_CLOEXEC | SOCK_NONBLOCK); client_fd >= 0) {
+                clients.emplace_back(client_fd);
+            }
+        }
+    }
+}
+
+bool QueryServer::read_requests(Client& client) {
+    if (const auto n = read_some(client.fd, client.input); n <= 0) {
+        if (n < 0 && errno == EAGAIN) {
+            return true;
+        }
+        // The client may still wait for the answers to requests it sent before closing its side.
+        client.reading = false;
+        return n == 0;
+    }
+
+    auto start = size_t{ 0 };
+    auto end = client.input.find('\n');
+    if (end != std::string::npos) {
+        refresh();
+    }
+    for (; end != std::string::npos; end = client.input.find('\n', start)) {
+        auto request = std::string_view(client.input).substr(start, end - start);
+        if (request.ends_with('\r')) {
+            request.remove_suffix(1);
+        }
+        client.output += (query ? query->answer(request) : "error: can't process sources\n") + "\n";
+        start = end + 1;
+    }
+    client.input.erase(0, start);
+
+    return write_answers(client);
+}
+
+bool QueryServer::write_answers(Client& client) {
+    while (!client.output.empty()) {
+        // A client that went away must not kill the server with SIGPIPE.
+        const auto n = send(client.fd, client.output.data(), client.output.size(), MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        }
+        client.output.erase(0, static_cast<size_t>(n));
+    }
+    return true;
+}
+
+void QueryServer::refresh() {
+    if (query && is_current()) {
+        return;
+    }
+    // The old query refers to the processed files that loading replaces.
+    query.reset();
+    try {
+        query = load();
+    } catch (const Exception& ex) {
+        if (*ex.what() != '\0') {
+            DiagnosticOutput::global.error("{}", ex.what());
+        }
+    }
+}
+
+#else
+
+QueryServer::QueryServer(std::filesystem::path socket_path, std::function<std::unique_ptr<Query>()> load, std::function<bool()> is_current) : socket_path{ std::move(socket_path) }, load{ std::move(load) }, is_current{ std::move(is_current) } { throw Exception("query server is not supported on this platform"); }
+
+QueryServer::~QueryServer() = default;
+
+bool QueryServer::is_supported() { return false; }
+
+void QueryServer::run() { throw Exception("query server is not supported on this platform"); }
+
+bool QueryServer::read_requests(Client& /*client*/) { return false; }
+
+bool QueryServer::write_answers(Client& /*client*/) { return false; }
+
+void QueryServer::refresh() {}
+
+#endif
@@ -0,0 +1,84 @@
+/*
+Copyright (C) Dieter Baron
+
+The authors can be contacted at <fast-ninja@tpau.group>
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+
+2. The names of the authors may not be used to endorse or promote
+  products derived from this software without specific prior
+  written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS
+OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef QUERY_SERVER_H
+#define QUERY_SERVER_H
+
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+class Query;
+
+/*
+ Serves queries on a Unix domain socket. Each request line is answered by the lines of the answer, followed by an empty line.
+ Before answering, the query is reloaded if the sources changed since it was loaded.
+ */
+class QueryServer {
+  public:
+    // load processes the sources and returns a query for them, is_current returns whether the sources are unchanged since then.
+    QueryServer(std::filesystem::path socket_path, std::function<std::unique_ptr<Query>()> load, std::function<bool()> is_current);
+    ~QueryServer();
+    QueryServer(const QueryServer&) = delete;
+    QueryServer& operator=(const QueryServer&) = delete;
+
+    [[nodiscard]] static bool is_supported();
+
+    [[noreturn]] void run();
+
+  private:
+    class Client {
+      public:
+        explicit Client(int fd) : fd{ fd } {}
+
+        int fd;
+        bool reading{ true };
+        std::string input;
+        // Answers not sent yet. Requests are only read once the client took all answers, so a client that doesn't read can't make it grow.
+        std::string output;
+    };
+
+    // Return false if the client can't be served anymore.
+    bool read_requests(Client& client);
+    static bool write_answers(Client& client);
+
+    // Reloads the query if the sources changed. If they can't be processed, there is no query until they are fixed.
+    void refresh();
+
+    std::filesystem::path socket_path;
+    std::function<std::unique_ptr<Query>()> load;
+    std::function<bool()> is_current;
+    std::unique_ptr<Query> query;
+    int fd{ -1 };
+    std::vector<Client> clients;
+};
+
+#endif // QUERY_SERVER_H
@@ -0,0 +1,269 @@
+/*
+Copyright (C) Dieter Baron
+
+The authors can be contacted at <fast-ninja@tpau.group>
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+
+2. The names of the authors may not be used to endorse or promote
+  products derived from this software without specific prior
+  written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS
+OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "config.h"
+
+#include "RegenerationState.h"
+
+#include <algorithm>
+#include <fstream>
+#include <ranges>
+
+#include "Hash.h"
+#include "Host.h"
+#include "OutputBuffer.h"
+
+namespace {
+void append_depfile_path(OutputBuffer& output, std::string_view path) {
+    for (const auto c : path) {
+        switch (c) {
+            case ' ':
+            case '#':
+            case '\\':
+                output << '\\' << c;
+                break;
+
+            case '$':
+                output << "$$";
+                break;
+
+            default:
+                output << c;
+                break;
+        }
+    }
+}
+
+// The existence of a file is tracked via the nearest existing directory above it, whose modification time changes when entries are added or removed.
+// The file itself is not tracked, since changes to its contents don't matter.
+std::filesystem::path existing_ancestor(std::filesystem::path path) {
+    do {
+        path = path.parent_path();
+    } while (!path.empty() && !std::filesystem::exists(path));
+
+    return path.empty() ? "." : path;
+}
+} // namespace
+
+/*
+ The state file consists of lines of the form
+
+ stamp HASH
+ argument ARGUMENT
+ source PATH
+ generated PATH
+ file FINGERPRINT NINJA-FILE
+ exists 0|1 PATH
+ host NAME VALUE
+
+ where each exists and host line belongs to the preceding file.
+ */
+
+RegenerationState::RegenerationState(const std::filesystem::path& filename) {
+    auto stream = std::ifstream(filename);
+    auto line = std::string{};
+    Entry* entry{};
+
+    while (std::getline(stream, line)) {
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        if (line.starts_with("stamp ")) {
+            if ((stamp = Hash::parse(std::string_view(line).substr(6)))) {
+                continue;
+            }
+        }
+        else if (line.starts_with("argument ")) {
+            arguments.emplace_back(line.substr(9));
+            continue;
+        }
+        else if (line.starts_with("source ")) {
+            sources[line.substr(7)] = 0;
+            continue;
+        }
+        else if (line.starts_with("generated ")) {
+            generated.insert(line.substr(10));
+            continue;
+        }
+        else if (line.starts_with("file ") && line.size() > 22 && line[21] == ' ') {
+            if (const auto fingerprint = Hash::parse(std::string_view(line).substr(5, 16))) {
+                entry = &entries[line.substr(22)];
+                entry->fingerprint = *fingerprint;
+                continue;
+            }
+        }
+        else if (entry && line.size() > 9 && line.starts_with("exists ") && (line[7] == '0' || line[7] == '1') && line[8] == ' ') {
+            entry->existence_checks[line.substr(9)] = line[7] == '1';
+            continue;
+        }
+        else if (entry && line.starts_with("host ")) {
+            if (const auto space = line.find(' ', 5); space != std::string::npos) {
+                entry->host_variables[line.substr(5, space - 5)] = line.substr(space + 1);
+                continue;
+            }
+        }
+
+        // Corrupt state, regenerate everything.
+        arguments.clear();
+        entries.clear();
+        generated.clear();
+        sources.clear();
+        stamp.reset();
+        return;
+    }
+}
+
+const RegenerationState::Entry* RegenerationState::find(const std::filesystem::path& ninja_file) const {
+    const auto it = entries.find(ninja_file.lexically_normal().generic_string());
+    if (it == entries.end()) {
+        return {};
+    }
+    return &it->second;
+}
+
+bool RegenerationState::Entry::is_valid() const {
+    return std::ranges::all_of(existence_checks, [](const auto& check) { return std::filesystem::exists(check.first) == check.second; }) && std::ranges::all_of(host_variables, [](const auto& pair) { return Host::variable(pair.first) == pair.second; });
+}
+
+std::vector<std::filesystem::path> RegenerationState::ninja_files() const {
+    auto files = std::vector<std::filesystem::path>{};
+    for (const auto& ninja_file : std::views::keys(entries)) {
+        files.emplace_back(ninja_file);
+    }
+    return files;
+}
+
+bool RegenerationState::is_up_to_date(const std::filesystem::path& top_source_file, const std::vector<std::string>& current_arguments) const {
+    if (!stamp || arguments != current_arguments || !sources.contains(top_source_file.lexically_normal().generic_string()) || compute_stamp() != stamp) {
+        return false;
+    }
+
+    if (!std::ranges::all_of(generated, [](const auto& file) { return std::filesystem::exists(file); })) {
+        return false;
+    }
+
+    return std::ranges::all_of(entries, [](const auto& pair) {
+        const auto& [ninja_file, entry] = pair;
+        return std::filesystem::exists(ninja_file) && entry.is_valid();
+    });
+}
+
+std::optional<uint64_t> RegenerationState::compute_stamp() const {
+    auto source_hashes = std::map<std::string, uint64_t>{};
+
+    for (const auto& source : std::views::keys(sources)) {
+        auto hash = Hash{};
+        if (!hash.update_file(source)) {
+            return {};
+        }
+        source_hashes[source] = hash.value();
+    }
+
+    return compute_stamp(source_hashes);
+}
+
+uint64_t RegenerationState::compute_stamp(const std::map<std::string, uint64_t>& source_hashes) {
+    auto hash = Hash{};
+
+    hash.update(VERSION);
+    for (const auto& [source, content_hash] : source_hashes) {
+        hash.update(source);
+        hash.update(content_hash);
+    }
+
+    return hash.value();
+}
+
+void RegenerationState::write(const std::filesystem::path& filename) const {
+    auto output = OutputBuffer{};
+
+    output << "# This file is automatically created by fast-ninja.\n";
+    output << "# Do not edit.\n";
+    // Stamp the contents that were parsed, not the current ones, so sources edited during generation are not considered up to date.
+    output << "stamp " << Hash::string(compute_stamp(sources)) << '\n';
+    for (const auto& argument : arguments) {
+        output << "argument " << argument << '\n';
+    }
+    for (const auto& source : std::views::keys(sources)) {
+        output << "source " << source << '\n';
+    }
+    for (const auto& file : generated) {
+        output << "generated " << file << '\n';
+    }
+    for (const auto& [ninja_file, entry] : entries) {
+        output << "file " << Hash::string(entry.fingerprint) << ' ' << ninja_file << '\n';
+        for (const auto& [path, exists] : entry.existence_checks) {
+            output << "exists " << (exists ? '1' : '0') << ' ' << path.generic_string() << '\n';
+        }
+        for (const auto& [name, value] : entry.host_variables) {
+            output << "host " << name << ' ' << value << '\n';
+        }
+    }
+
+    output.write_if_changed(filename);
+}
+
+std::set<std::string> RegenerationState::dependencies() const {
+    auto dependencies = std::set<std::string>{};
+    for (const auto& source : std::views::keys(sources)) {
+        dependencies.insert(source);
+    }
+    for (const auto& entry : std::views::values(entries)) {
+        for (const auto& path : std::views::keys(entry.existence_checks)) {
+            dependencies.insert(existing_ancestor(path).generic_string());
+        }
+    }
+    return dependencies;
+}
+
+void RegenerationState::write_depfile(const std::filesystem::path& filename) const {
+    auto output = OutputBuffer{};
+    auto first = true;
+    for (const auto& target : std::views::keys(entries)) {
+        if (first) {
+            first = false;
+        }
+        else {
+            output << ' ';
+        }
+        append_depfile_path(output, target);
+    }
+    for (const auto& target : generated) {
+        output << ' ';
+        append_depfile_path(output, target);
+    }
+    output << ':';
+    for (const auto& dependency : dependencies()) {
+        output << " \\\n    ";
+        append_depfile_path(output, dependency);
+    }
+    output << '\n';
+
+    output.write_if_changed(filename);
+}
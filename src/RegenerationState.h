@@ -0,0 +1,101 @@
+/*
+Copyright (C) Dieter Baron
+
+The authors can be contacted at <fast-ninja@tpau.group>
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+
+2. The names of the authors may not be used to endorse or promote
+  products derived from this software without specific prior
+  written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS
+OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef REGENERATION_STATE_H
+#define REGENERATION_STATE_H
+
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <optional>
+#include <set>
+#include <string>
+#include <vector>
+
+/*
+ Information about the previous run, kept in the build directory.
+ For each generated ninja file, it records a fingerprint of everything the file was generated from and the results of all file existence checks made while resolving it.
+ If neither changed, the file is still up to date and doesn't need to be resolved or written again.
+
+ It also records a stamp over the contents of all source files. If the stamp and all existence checks still match and all generated files exist, nothing needs to be done at all.
+ This check is cheap and is done before parsing anything.
+ */
+class RegenerationState {
+  public:
+    class Entry {
+      public:
+        uint64_t fingerprint{};
+        std::map<std::filesystem::path, bool> existence_checks;
+        std::map<std::string, std::string> host_variables;
+
+        // Checks that all files checked still (don't) exist and all host variables used still have the same value.
+        [[nodiscard]] bool is_valid() const;
+    };
+
+    RegenerationState() = default;
+    explicit RegenerationState(const std::filesystem::path& filename);
+
+    void add(const std::filesystem::path& ninja_file, Entry entry) { entries[ninja_file.lexically_normal().generic_string()] = std::move(entry); }
+
+    void add_generated(const std::filesystem::path& file) { generated.insert(file.lexically_normal().generic_string()); }
+
+    // Records a source file with the hash of its contents as they were parsed.
+    void add_source(const std::filesystem::path& file, uint64_t content_hash) { sources[file.lexically_normal().generic_string()] = content_hash; }
+
+    void set_arguments(const std::vector<std::string>& new_arguments) { arguments = new_arguments; }
+
+    [[nodiscard]] const Entry* find(const std::filesystem::path& ninja_file) const;
+    [[nodiscard]] std::vector<std::filesystem::path> ninja_files() const;
+
+    // All source files, plus for each file whose existence was checked, its nearest existing ancestor directory.
+    [[nodiscard]] std::set<std::string> dependencies() const;
+    [[nodiscard]] bool is_up_to_date(const std::filesystem::path& top_source_file, const std::vector<std::string>& current_arguments) const;
+
+    void write(const std::filesystem::path& filename) const;
+    // Writes a depfile for the generator build, listing all dependencies.
+    void write_depfile(const std::filesystem::path& filename) const;
+
+    [[nodiscard]] static std::filesystem::path depfile_filename(const std::filesystem::path& build_directory) { return build_directory / ".fast-ninja.d"; }
+
+    [[nodiscard]] static std::filesystem::path filename(const std::filesystem::path& build_directory) { return build_directory / ".fast-ninja-state"; }
+
+  private:
+    // Stamp over the current contents of all sources.
+    [[nodiscard]] std::optional<uint64_t> compute_stamp() const;
+    [[nodiscard]] static uint64_t compute_stamp(const std::map<std::string, uint64_t>& source_hashes);
+
+    std::vector<std::string> arguments;
+    std::map<std::string, Entry> entries;
+    std::set<std::string> generated;
+    // Content hashes are only known for sources added in this run.
+    std::map<std::string, uint64_t> sources;
+    std::optional<uint64_t> stamp;
+};
+
+#endif // REGENERATION_STATE_H
@@ -0,0 +1,108 @@
+/*
+Copyright (C) Dieter Baron
+
+The authors can be contacted at <fast-ninja@tpau.group>
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+
+2. The names of the authors may not be used to endorse or promote
+  products derived from this software without specific prior
+  written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS
+OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "Report.h"
+
+#include <algorithm>
+#include <optional>
+#include <ranges>
+
+#include "FastNinjaUtil.h"
+
+namespace {
+std::string to_string(const std::string& string) { return string; }
+std::string to_string(const std::filesystem::path& path) { return path.generic_string(); }
+} // namespace
+
+void Report::add(const BuildLocations& locations) {
+    for (const auto& entry : locations.entries) {
+        // All outputs of a build are logged with the same times.
+        auto duration = std::optional<uint64_t>{};
+        for (const auto& output : entry.outputs) {
+            if (const auto output_duration = log.duration(output)) {
+                duration = std::max(duration.value_or(0), *output_duration);
+            }
+        }
+        if (!duration) {
+            continue;
+        }
+
+        builds.emplace_back(entry.location.empty() ? entry.outputs.front() : entry.outputs.front() + " (" + source_location(entry.location) + ")", *duration);
+        rules[entry.rule].add(*duration);
+        files[source_name(locations.source_file)].add(*duration);
+    }
+}
+
+// Locations are of the form FILE:LINE.COLUMN, only the file name needs adjusting.
+std::string Report::source_location(const std::string& location) const {
+    const auto colon = location.rfind(':');
+    if (colon == std::string::npos) {
+        return location;
+    }
+    return source_name(location.substr(0, colon)).generic_string() + location.substr(colon);
+}
+
+void Report::print(OutputBuffer& output, size_t count) const {
+    auto slowest_builds = builds;
+    std::ranges::stable_sort(slowest_builds, std::greater<>{}, [](const auto& build) { return build.second; });
+    output << "slowest builds:\n";
+    for (size_t i = 0; i < std::min(count, slowest_builds.size()); i++) {
+        output << "    " << format_duration(slowest_builds[i].second) << ' ' << slowest_builds[i].first << '\n';
+    }
+
+    print_slowest(output, "rules", rules, count);
+    print_slowest(output, "files", files, count);
+
+    // A directory includes the files of all directories below it.
+    auto directories = std::map<std::filesystem::path, Total>{};
+    for (const auto& file : std::views::keys(files)) {
+        directories[file.parent_path()];
+    }
+    for (auto& [directory, total] : directories) {
+        for (const auto& [file, file_total] : files) {
+            const auto relative = file.parent_path().lexically_relative(directory);
+            if (!relative.empty() && *relative.begin() != "..") {
+                total.builds += file_total.builds;
+                total.duration += file_total.duration;
+            }
+        }
+    }
+    print_slowest(output, "directories", directories, count);
+}
+
+template <typename Key> void Report::print_slowest(OutputBuffer& output, std::string_view title, const std::map<Key, Total>& totals, size_t count) {
+    auto slowest = std::vector<std::pair<Key, Total>>{ totals.begin(), totals.end() };
+    std::ranges::stable_sort(slowest, std::greater<>{}, [](const auto& pair) { return pair.second.duration; });
+
+    output << "slowest " << title << ":\n";
+    for (size_t i = 0; i < std::min(count, slowest.size()); i++) {
+        const auto& [key, total] = slowest[i];
+        output << "    " << format_duration(total.duration) << ' ' << to_string(key) << ": " << std::to_string(total.builds) << (total.builds == 1 ? " build\n" : " builds\n");
+    }
+}
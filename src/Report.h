@@ -0,0 +1,77 @@
+/*
+Copyright (C) Dieter Baron
+
+The authors can be contacted at <fast-ninja@tpau.group>
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+
+2. The names of the authors may not be used to endorse or promote
+  products derived from this software without specific prior
+  written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS
+OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef REPORT_H
+#define REPORT_H
+
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "BuildLocations.h"
+#include "NinjaLog.h"
+#include "OutputBuffer.h"
+
+// Build times from ninja's log, attributed to builds, rules, source files and directories.
+// Source file names are reported relative to the current directory.
+class Report {
+  public:
+    Report(const NinjaLog& log, std::filesystem::path build_directory) : log{ log }, build_directory{ std::move(build_directory) } {}
+
+    void add(const BuildLocations& locations);
+
+    void print(OutputBuffer& output, size_t count = 5) const;
+
+  private:
+    class Total {
+      public:
+        size_t builds{};
+        uint64_t duration{};
+
+        void add(uint64_t build_duration) {
+            builds += 1;
+            duration += build_duration;
+        }
+    };
+
+    template <typename Key> static void print_slowest(OutputBuffer& output, std::string_view title, const std::map<Key, Total>& totals, size_t count);
+    // Returns the name of a source file given relative to the build directory, relative to the current directory.
+    [[nodiscard]] std::filesystem::path source_name(const std::filesystem::path& name) const { return (build_directory / name).lexically_normal(); }
+    [[nodiscard]] std::string source_location(const std::string& location) const;
+
+    const NinjaLog& log;
+    std::filesystem::path build_directory;
+    std::vector<std::pair<std::string, uint64_t>> builds;
+    std::map<std::string, Total> rules;
+    std::map<std::filesystem::path, Total> files;
+};
+
+#endif // REPORT_H
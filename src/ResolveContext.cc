@@ -29,7 +29,7 @@ IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "ResolveContext.h"
 
-const Variable* ResolveContext::get_variable(const std::string& name) const {
+const Variable* ResolveContext::get_variable(std::string_view name) const {
     const auto variable = scope.get_variable(name);
     return variable;
 }
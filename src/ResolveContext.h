@@ -40,7 +40,7 @@ class ResolveContext {
     // TODO: expand_variables should default to true
     ResolveContext(const Scope& scope, ResolveResult& result, bool expand_variables = false, bool classify_filenames = true) : scope{ scope }, result{ result }, expand_variables{ expand_variables }, classify_filenames{ classify_filenames } {}
 
-    [[nodiscard]] const Variable* get_variable(const std::string& name) const;
+    [[nodiscard]] const Variable* get_variable(std::string_view name) const;
 
     const Scope& scope;
     bool expand_variables;
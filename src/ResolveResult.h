@@ -31,13 +31,19 @@ IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 
 #include <string>
-#include <unordered_set>
+#include <string_view>
+
+#include "FastNinjaUtil.h"
 
 class ResolveResult {
   public:
-    void add_unresolved_variable_use(const std::string& name) { unresolved_used_variables.insert(name); }
+    void add_unresolved_variable_use(std::string_view name) {
+        if (!unresolved_used_variables.contains(name)) {
+            unresolved_used_variables.emplace(name);
+        }
+    }
 
-    std::unordered_set<std::string> unresolved_used_variables;
+    StringSet unresolved_used_variables;
 };
 
 
@@ -29,18 +29,143 @@ IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "Rule.h"
 
+#include <cctype>
+#include <optional>
+#include <string_view>
+
+#include <tpau-cpp-kernal/DiagnosticOutput.h>
+#include <tpau-cpp-kernal/Exception.h>
+
+#include "FastNinjaUtil.h"
 #include "File.h"
+#include "TextVariable.h"
+#include "WorkerSupervisor.h"
+
+using namespace tpau::cpp_kernal;
+
+namespace {
+// Returns the first character in command, as written in a ninja file, that the shell would treat specially, or nothing.
+std::optional<char> find_shell_syntax(std::string_view command) {
+    for (size_t index = 0; index < command.size(); index++) {
+        const auto c = command[index];
+        if (c == '$' && index + 1 < command.size()) {
+            // Variable references expand to file names and arguments, and escaped spaces and colons are literal.
+            const auto next = command[index + 1];
+            if (next == '{') {
+                index = command.find('}', index);
+                if (index == std::string_view::npos) {
+                    return {};
+                }
+                continue;
+            }
+            if (next == ' ' || next == ':' || std::isalnum(static_cast<unsigned char>(next)) || next == '_' || next == '-') {
+                index++;
+                while (index + 1 < command.size() && (std::isalnum(static_cast<unsigned char>(command[index + 1])) || command[index + 1] == '_' || command[index + 1] == '-')) {
+                    index++;
+                }
+                continue;
+            }
+            return '$';
+        }
+        if (std::string_view(";&|<>'\"`\\()*?").find(c) != std::string_view::npos) {
+            return c;
+        }
+    }
+    return {};
+}
+} // namespace
 
-Rule::Rule(const File* file, std::string name, Tokenizer& tokenizer) : ScopedDirective{ file }, name{ std::move(name) } {
+Rule::Rule(const File* file, std::string name, Tokenizer& tokenizer, Location location) : ScopedDirective{ file }, location{ std::move(location) }, name{ std::move(name) } {
     tokenizer.expect(Tokenizer::TokenType::NEWLINE, Tokenizer::Skip::SPACE);
     bindings = Bindings{ tokenizer };
+    parse_flags();
 }
 
-Rule::Rule(const File* file, std::string name, Bindings bindings) : ScopedDirective{ file, std::move(bindings) }, name{ std::move(name) } {}
+Rule::Rule(const File* file, std::string name, Bindings bindings) : ScopedDirective{ file, std::move(bindings) }, name{ std::move(name) } { parse_flags(); }
+
+void Rule::parse_flags() {
+    cached = parse_flag("cache");
+    worker = parse_flag("worker");
+}
+
+// Flags are not ninja variables, so they are never written.
+bool Rule::parse_flag(const std::string& flag) {
+    const auto variable = bindings.take(flag);
+    if (!variable) {
+        return false;
+    }
+    const auto value = variable->string();
+    if (value != "0" && value != "1") {
+        DiagnosticOutput::global.error(location, "rule {}: {} must be 0 or 1", name, flag);
+        throw Exception();
+    }
+    return value == "1";
+}
 
-void Rule::process(const File& file) { bindings.resolve(file, false); }
+void Rule::process(const File& file) {
+    bindings.resolve(file, false);
+    if (const auto pool = bindings.find("pool"); pool && !file.is_valid_pool(pool->string())) {
+        DiagnosticOutput::global.error(location, "rule {}: unknown pool '{}'", name, pool->string());
+        throw Exception();
+    }
+    if (worker && WorkerSupervisor::is_supported()) {
+        wrap_in_worker();
+    }
+    if (cached && !file.top_file()->options.cache_directory.empty()) {
+        wrap_in_cache(file.top_file()->options);
+    }
+}
+
+/*
+ The original command is passed to the launcher in a response file, so the shell runs it unchanged.
+ The builds provide the response file name and the complete lists of outputs and inputs, which ninja has no variables for, quoted for the shell.
+ */
+void Rule::wrap_in_cache(const Options& options) {
+    for (const auto binding : { "depfile", "deps", "rspfile" }) {
+        if (bindings.find(binding)) {
+            DiagnosticOutput::global.error(location, "rule {}: cache can't be used with {}", name, binding);
+            throw Exception();
+        }
+    }
+    auto command = bindings.take("command");
+    if (!command) {
+        DiagnosticOutput::global.error(location, "rule {}: no command", name);
+        throw Exception();
+    }
+    command->name = "rspfile_content";
+    bindings.add(std::move(command));
+
+    bindings.add(std::make_unique<TextVariable>("rspfile", Text{ std::vector<Word>{ Word{ VariableReference{ "cache_command" } } } }));
+    auto launcher = std::vector<Word>{};
+    launcher.emplace_back("fast-ninja --cached-exec ", false);
+    launcher.emplace_back(shell_quote(options.cache_directory), true);
+    launcher.emplace_back(" " + std::to_string(options.cache_size) + " ", false);
+    launcher.emplace_back(VariableReference{ "cache_outputs" });
+    launcher.emplace_back(" -- ", false);
+    launcher.emplace_back(VariableReference{ "cache_inputs" });
+    bindings.add(std::make_unique<TextVariable>("command", Text{ launcher }));
+}
+
+/*
+ The client passes the command to a persistent worker of the tool, so it must be a simple command: the tool followed by its arguments.
+ The worker client is run in the top build directory, so all builds share one supervisor.
+ */
+void Rule::wrap_in_worker() {
+    auto command = bindings.take("command");
+    if (!command || !command->is_text()) {
+        DiagnosticOutput::global.error(location, "rule {}: no command", name);
+        throw Exception();
+    }
+    if (const auto c = find_shell_syntax(command->string())) {
+        DiagnosticOutput::global.error(location, "rule {}: worker command can't use shell syntax '{}'", name, *c);
+        throw Exception();
+    }
+    auto text = Text{ std::vector<Word>{ Word{ "fast-ninja --worker-client " + std::string(WorkerSupervisor::socket_name) + " -- ", false } } };
+    text.append(command->as_text()->get_value());
+    bindings.add(std::make_unique<TextVariable>("command", std::move(text)));
+}
 
-void Rule::print(std::ostream& stream) const {
-    stream << std::endl << "rule " << name << std::endl;
-    bindings.print(stream, "    ");
+void Rule::print(OutputBuffer& output) const {
+    output << "\nrule " << name << '\n';
+    bindings.print(output, "    ");
 }
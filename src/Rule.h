@@ -32,6 +32,7 @@ IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <string>
 
+#include "Options.h"
 #include "ScopedDirective.h"
 #include "Variable.h"
 
@@ -40,14 +41,28 @@ class File;
 class Rule : public ScopedDirective {
   public:
     Rule() = default;
-    Rule(const File* file, std::string name, Tokenizer& tokenizer);
+    Rule(const File* file, std::string name, Tokenizer& tokenizer, Location location);
     Rule(const File* file, std::string name, Bindings bindings);
 
     void process(const File& file);
-    void print(std::ostream& stream) const;
+    void print(OutputBuffer& output) const;
+
+    void collect_variable_references(StringSet& names) const { bindings.collect_variable_references(names); }
+
+    [[nodiscard]] bool is_cached() const { return cached; }
+    [[nodiscard]] bool is_worker() const { return worker; }
+
+    Location location;
 
   private:
+    void parse_flags();
+    [[nodiscard]] bool parse_flag(const std::string& flag);
+    void wrap_in_cache(const Options& options);
+    void wrap_in_worker();
+
     std::string name;
+    bool cached{ false };
+    bool worker{ false };
 };
 
 #endif // RULE_H
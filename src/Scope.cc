@@ -31,16 +31,18 @@ IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "File.h"
 
-Variable* Scope::get_variable(const std::string& name) const {
+Variable* Scope::get_variable(std::string_view name) const {
     auto scope = this;
     while (scope) {
-        auto it = scope->bindings.find(name);
-        if (it != scope->bindings.end()) {
-            return it->second.get();
+        if (const auto variable = scope->bindings.find(name)) {
+            return variable;
         }
         scope = scope->next;
     }
 
+    if (const auto file = get_file()) {
+        return file->host_variable(name);
+    }
     return {};
 }
 
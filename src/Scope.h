@@ -42,6 +42,8 @@ class Scope {
 
     Scope(const Scope* next, Bindings bindings) : next{ next }, bindings{ std::move(bindings) } {}
 
+    Scope(Scope&&) = default;
+    Scope& operator=(Scope&&) = default;
     virtual ~Scope() = default;
 
     [[nodiscard]] bool is_top() const { return !next; }
@@ -51,7 +53,7 @@ class Scope {
 
     [[nodiscard]] bool is_file() const { return as_file(); }
 
-    [[nodiscard]] Variable* get_variable(const std::string& name) const;
+    [[nodiscard]] Variable* get_variable(std::string_view name) const;
     [[nodiscard]] const File* get_file() const;
     [[nodiscard]] bool is_output_file(const std::filesystem::path& file) const;
 
@@ -46,14 +46,14 @@ Text::Text(Tokenizer& tokenizer) {
     }
 }
 
-std::ostream& operator<<(std::ostream& stream, const Text& text) {
-    text.print(stream);
-    return stream;
+OutputBuffer& operator<<(OutputBuffer& output, const Text& text) {
+    text.print(output);
+    return output;
 }
 
-void Text::print(std::ostream& stream) const {
+void Text::print(OutputBuffer& output) const {
     for (auto& word : words) {
-        stream << word;
+        output << word;
     }
 }
 
@@ -67,12 +67,16 @@ void Text::resolve(const ResolveContext& context) {
     }
 }
 
+void Text::collect_variable_references(StringSet& names) const {
+    for (const auto& word : words) {
+        word.collect_variable_references(names);
+    }
+}
+
 std::string Text::string() const {
-    auto result = std::string{};
+    auto output = OutputBuffer{};
 
-    for (auto& word : words) {
-        result += word.string();
-    }
+    print(output);
 
-    return result;
+    return output.release();
 }
@@ -33,6 +33,8 @@ IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <string>
 #include <vector>
 
+#include "FastNinjaUtil.h"
+#include "OutputBuffer.h"
 #include "Tokenizer.h"
 #include "Word.h"
 
@@ -61,7 +63,7 @@ class Text {
 
     void emplace_back(const Word& element) { words.emplace_back(element); }
 
-    void print(std::ostream& stream) const;
+    void print(OutputBuffer& output) const;
     void resolve(const ResolveContext& scope);
 
     [[nodiscard]] bool empty() const { return words.empty(); }
@@ -72,6 +74,8 @@ class Text {
 
     [[nodiscard]] bool is_resolved() const { return resolved; }
 
+    void collect_variable_references(StringSet& names) const;
+
     [[nodiscard]] Location location() const { return {}; } // TODO
 
   private:
@@ -79,6 +83,6 @@ class Text {
     bool resolved{ true };
 };
 
-std::ostream& operator<<(std::ostream& stream, const Text& text);
+OutputBuffer& operator<<(OutputBuffer& output, const Text& text);
 
 #endif // TEXT_H
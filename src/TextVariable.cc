@@ -31,4 +31,4 @@ IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 void TextVariable::resolve(const ResolveContext& context) { value.resolve(context); }
 
-void TextVariable::print_definition(std::ostream& stream) const { stream << name << " = " << value << std::endl; }
+void TextVariable::print_definition(OutputBuffer& output) const { output << name << " = " << value << '\n'; }
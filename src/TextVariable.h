@@ -40,12 +40,18 @@ class TextVariable : public Variable {
     TextVariable(std::string name, Text value) : Variable(std::move(name)), value{ std::move(value) } {}
 
     void resolve(const ResolveContext& scope) override;
-    void print_definition(std::ostream& stream) const override;
+    void print_definition(OutputBuffer& output) const override;
 
     [[nodiscard]] std::string string() const override { return value.string(); }
 
+    [[nodiscard]] const Text& get_value() const { return value; }
+
+    [[nodiscard]] std::unique_ptr<Variable> clone() const override { return std::make_unique<TextVariable>(*this); }
+
     [[nodiscard]] bool contains_unknown_file() const override { return value.contains_unknown_file(); }
 
+    void collect_variable_references(StringSet& names) const override { value.collect_variable_references(names); }
+
     bool is_resolved() const override { return value.is_resolved(); }
 
   private:
@@ -29,12 +29,16 @@ IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "Tokenizer.h"
 
+#include <cstdio>
+
 #include <tpau-cpp-kernal/Exception.h>
 
+#include "Hash.h"
+
 using namespace tpau::cpp_kernal;
 
 // clang-format off
-std::unordered_map<std::string, Tokenizer::TokenType> Tokenizer::keywords = {
+StringMap<Tokenizer::TokenType> Tokenizer::keywords = {
     {"build", TokenType::BUILD},
     {"built-files-list", TokenType::BUILT_FILES},
     {"default", TokenType::DEFAULT},
@@ -65,6 +69,22 @@ std::unordered_map<int, Tokenizer::CharacterType> Tokenizer::special_characters
 
 Tokenizer::Tokenizer(const std::filesystem::path& filename) : filename{ filename }, source{ Symbol(filename.string()) } {}
 
+bool Tokenizer::Token::is_keyword() const {
+    switch (type) {
+        case TokenType::BUILD:
+        case TokenType::BUILT_FILES:
+        case TokenType::DEFAULT:
+        case TokenType::INCLUDE:
+        case TokenType::POOL:
+        case TokenType::RULE:
+        case TokenType::SUBNINJA:
+            return true;
+
+        default:
+            return false;
+    }
+}
+
 std::string Tokenizer::Token::string() const {
     if (type == TokenType::VARIABLE_REFERENCE) {
         return "$" + value;
@@ -279,7 +299,7 @@ Tokenizer::Token Tokenizer::get_next() {
                 if (begining_of_line) {
                     if (indent > 0) {
                         indent = 0;
-                        source.unget();
+                        unread_character();
                         return Token{ location, TokenType::END_SCOPE };
                     }
                     break;
@@ -424,6 +444,33 @@ Tokenizer::Token Tokenizer::tokenize_variable(Location location, Character c) {
     return Token{ location, TokenType::VARIABLE_REFERENCE, name };
 }
 
+uint64_t Tokenizer::content_hash() const { return Hash::hash(content, 0); }
+
+// Keep a copy of what was read, so the contents can be hashed exactly as they were parsed.
+int Tokenizer::read_character() {
+    const auto c = source.get();
+    if (c == EOF) {
+        past_end = true;
+    }
+    else {
+        if (position == content.size()) {
+            content.push_back(static_cast<char>(c));
+        }
+        position++;
+    }
+    return c;
+}
+
+void Tokenizer::unread_character() {
+    source.unget();
+    if (past_end) {
+        past_end = false;
+    }
+    else {
+        position--;
+    }
+}
+
 Tokenizer::Character Tokenizer::next_character() {
     if (ungot_character) {
         auto c = *ungot_character;
@@ -431,14 +478,14 @@ Tokenizer::Character Tokenizer::next_character() {
         return c;
     }
 
-    auto c = source.get();
+    auto c = read_character();
     if (c == '$') {
-        auto c2 = source.get();
+        auto c2 = read_character();
         if (c2 == ' ' || c2 == '$' || c2 == '\n' || c2 == ':') {
             return { CharacterType::SIMPLE_VARIABLE, c2 };
         }
         else {
-            source.unget();
+            unread_character();
             return Character{ c };
         }
     }
@@ -32,6 +32,7 @@ IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #ifndef TOKENIZER_H
 #define TOKENIZER_H
 
+#include <cstdint>
 #include <filesystem>
 #include <fstream>
 #include <optional>
@@ -41,6 +42,8 @@ IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <tpau-cpp-kernal/FileSource.h>
 #include <tpau-cpp-kernal/Location.h>
 
+#include "FastNinjaUtil.h"
+
 using namespace tpau::cpp_kernal;
 
 class Tokenizer {
@@ -94,6 +97,8 @@ class Tokenizer {
 
         explicit operator bool() const { return type != TokenType::END; }
 
+        [[nodiscard]] bool is_keyword() const;
+
         [[nodiscard]] bool is_variable_reference() const { return type == TokenType::VARIABLE_REFERENCE; }
 
         [[nodiscard]] bool is_whitespace() const { return type == TokenType::SPACE || type == TokenType::NEWLINE; }
@@ -117,7 +122,12 @@ class Tokenizer {
 
     [[nodiscard]] const std::filesystem::path& file_name() const { return filename; }
 
+    // Hash of the contents read so far, covering the whole file once END was returned.
+    [[nodiscard]] uint64_t content_hash() const;
+
   private:
+    [[nodiscard]] int read_character();
+    void unread_character();
     [[nodiscard]] Character next_character();
     void unget_character(Character c);
     [[nodiscard]] Token get_next();
@@ -128,11 +138,14 @@ class Tokenizer {
     [[nodiscard]] Token tokenize_variable(Location location, Character first_character);
     [[nodiscard]] Token tokenize_word(Location location, Character first_character);
 
-    static std::unordered_map<std::string, TokenType> keywords;
+    static StringMap<TokenType> keywords;
     static std::unordered_map<int, CharacterType> special_characters;
 
     std::filesystem::path filename;
     FileSource source;
+    std::string content;
+    size_t position = 0;
+    bool past_end = false;
     std::optional<Character> ungot_character;
     std::optional<Token> ungot;
     bool begining_of_line = true;
@@ -29,8 +29,6 @@ IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "Variable.h"
 
-#include <iostream>
-
 #include "FilenameVariable.h"
 #include "ResolveContext.h"
 #include "TextVariable.h"
@@ -30,8 +30,11 @@ IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #ifndef VARIABLE_H
 #define VARIABLE_H
 
+#include <memory>
 #include <string>
 
+#include "FastNinjaUtil.h"
+#include "OutputBuffer.h"
 #include "Tokenizer.h"
 
 class ResolveContext;
@@ -55,9 +58,12 @@ class Variable {
     [[nodiscard]] virtual bool is_resolved() const = 0;
 
     virtual void resolve(const ResolveContext& context) = 0;
-    virtual void print_definition(std::ostream& stream) const = 0;
+    virtual void print_definition(OutputBuffer& output) const = 0;
     [[nodiscard]] virtual bool contains_unknown_file() const = 0;
+    // Adds the names of variables that are left for ninja to expand.
+    virtual void collect_variable_references(StringSet& names) const = 0;
     [[nodiscard]] virtual std::string string() const = 0;
+    [[nodiscard]] virtual std::unique_ptr<Variable> clone() const = 0;
 
     std::string name;
 
@@ -35,34 +35,44 @@ IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <tpau-cpp-kernal/Exception.h>
 
+#include "Bindings.h"
+
 using namespace tpau::cpp_kernal;
 
-VariableDependencies::VariableDependencies(const std::unordered_map<std::string, std::shared_ptr<Variable>>& variables) {
-    for (auto& name : std::views::keys(variables)) {
-        unresolved[name] = {};
-        known_variables.insert(name);
+VariableDependencies::VariableDependencies(const Bindings& bindings) {
+    for (const auto& variable : bindings) {
+        unresolved[variable->name] = {};
+        known_variables.insert(variable->name);
     }
 }
 
-void VariableDependencies::update(const std::string& name, const std::unordered_set<std::string>& dependencies) {
+void VariableDependencies::update(std::string_view name, const StringSet& dependencies) {
+    const auto it = unresolved.find(name);
     if (dependencies.empty()) {
-        resolved.insert(name);
-        unresolved.erase(name);
+        resolved.emplace(name);
+        if (it != unresolved.end()) {
+            unresolved.erase(it);
+        }
     }
     else {
         if (!std::ranges::all_of(dependencies, [this](const auto& name) { return known_variables.contains(name); })) {
             throw Exception("unknown variable"); // TODO: include name
         }
-        unresolved[name] = dependencies;
+        if (it != unresolved.end()) {
+            it->second = dependencies;
+        }
+        else {
+            unresolved.emplace(name, dependencies);
+        }
     }
 }
 
-std::unordered_set<std::string> VariableDependencies::get_next() const {
+StringSet VariableDependencies::get_next() const {
     if (finished()) {
         return {};
     }
 
-    std::unordered_set<std::string> next;
+    StringSet next;
 
     for (auto& pair : unresolved) {
         if (std::ranges::all_of(pair.second, [this](const std::string& dependency) { return resolved.contains(dependency); })) {
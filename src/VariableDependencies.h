@@ -30,26 +30,26 @@ OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
 IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 
-#include <memory>
 #include <string>
-#include <unordered_map>
-#include <unordered_set>
+#include <string_view>
 
-class Variable;
+#include "FastNinjaUtil.h"
+
+class Bindings;
 
 class VariableDependencies {
   public:
-    VariableDependencies(const std::unordered_map<std::string, std::shared_ptr<Variable>>& variables);
-    void update(const std::string& name, const std::unordered_set<std::string>& dependencies);
+    VariableDependencies(const Bindings& bindings);
+    void update(std::string_view name, const StringSet& dependencies);
 
     [[nodiscard]] bool finished() const { return unresolved.empty(); }
 
-    std::unordered_set<std::string> get_next() const;
+    StringSet get_next() const;
 
   private:
-    std::unordered_map<std::string, std::unordered_set<std::string>> unresolved;
-    std::unordered_set<std::string> resolved;
-    std::unordered_set<std::string> known_variables;
+    StringMap<StringSet> unresolved;
+    StringSet resolved;
+    StringSet known_variables;
 };
 
 #endif // VARIABLE_DEPENDENCIES_H
@@ -0,0 +1,107 @@
+/*
+Copyright (C) Dieter Baron
+
+The authors can be contacted at <fast-ninja@tpau.group>
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+
+2. The names of the authors may not be used to endorse or promote
+  products derived from this software without specific prior
+  written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS
+OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "config.h"
+
+#include "Watcher.h"
+
+#include <tpau-cpp-kernal/Exception.h>
+
+#ifdef HAVE_INOTIFY
+#include <array>
+#include <cstring>
+#include <cerrno>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+using namespace tpau::cpp_kernal;
+
+#ifdef HAVE_INOTIFY
+namespace {
+constexpr auto settle_milliseconds = 100;
+
+bool wait_readable(int fd, int timeout) {
+    auto poll_fd = pollfd{ fd, POLLIN, 0 };
+    while (true) {
+        const auto ret = poll(&poll_fd, 1, timeout);
+        if (ret >= 0) {
+            return ret > 0;
+        }
+        if (errno != EINTR) {
+            throw Exception("can't wait for changes: {}", std::strerror(errno));
+        }
+    }
+}
+
+void drain(int fd) {
+    auto buffer = std::array<char, 4096>{};
+    while (read(fd, buffer.data(), buffer.size()) > 0) {
+    }
+}
+} // namespace
+
+Watcher::Watcher() : fd{ inotify_init1(IN_NONBLOCK | IN_CLOEXEC) } {
+    if (fd < 0) {
+        throw Exception("can't watch for changes: {}", std::strerror(errno));
+    }
+}
+
+Watcher::~Watcher() { close(fd); }
+
+bool Watcher::is_supported() { return true; }
+
+void Watcher::add(const std::filesystem::path& directory) {
+    // Editors often save by renaming a new file into place, so watch directories rather than the files themselves.
+    if (inotify_add_watch(fd, directory.c_str(), IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF) < 0) {
+        throw Exception("can't watch '{}': {}", directory.string(), std::strerror(errno));
+    }
+}
+
+void Watcher::wait() const {
+    wait_readable(fd, -1);
+    do {
+        drain(fd);
+    } while (wait_readable(fd, settle_milliseconds));
+}
+
+#else
+
+Watcher::Watcher() = default;
+
+Watcher::~Watcher() = default;
+
+bool Watcher::is_supported() { return false; }
+
+void Watcher::add(const std::filesystem::path& /*directory*/) {}
+
+void Watcher::wait() const { throw Exception("watching for changes is not supported on this platform"); }
+
+#endif
@@ -29,8 +29,6 @@ IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "Word.h"
 
-#include <sstream>
-
 #include <tpau-cpp-kernal/Exception.h>
 
 #include "FilenameVariable.h"
@@ -69,71 +67,75 @@ Word::Word(Tokenizer& tokenizer) {
 }
 
 std::string Word::string() const {
-    auto stream = std::stringstream{};
+    auto output = OutputBuffer{};
 
-    stream << *this;
+    print(output);
 
-    return stream.str();
+    return output.release();
 }
 
-void Word::print(std::ostream& stream) const {
-    std::string prefix;
-    std::string postfix;
-    std::string* current_string = &prefix;
-    const FilenameVariable* filename_variable{};
-    const FilenameWord* filename_word{};
+void Word::print(OutputBuffer& output) const {
+    // Index of the element that expands to a list of file names, if any.
+    auto filename_index = elements.size();
 
-    for (auto& element : elements) {
-        if (std::holds_alternative<StringElement>(element)) {
-            *current_string += std::get<StringElement>(element).string();
-        }
-        else if (std::holds_alternative<VariableReference>(element)) {
-            auto& variable_reference = std::get<VariableReference>(element);
-            *current_string += "$" + variable_reference.name;
-        }
-        else if (std::holds_alternative<const Variable*>(element)) {
-            auto& variable = std::get<const Variable*>(element);
-            if (variable->is_text()) {
-                *current_string += variable->string();
-            }
-            else {
-                if (filename_variable || filename_word) {
-                    throw Exception("multiple file names in word not allowed");
-                }
-                filename_variable = variable->as_filename();
-                current_string = &postfix;
-            }
-        }
-        else if (std::holds_alternative<FilenameWord>(element)) {
-            if (filename_variable || filename_word) {
+    for (size_t index = 0; index < elements.size(); index++) {
+        const auto& element = elements[index];
+        if (std::holds_alternative<FilenameWord>(element) || (std::holds_alternative<const Variable*>(element) && !std::get<const Variable*>(element)->is_text())) {
+            if (filename_index != elements.size()) {
                 throw Exception("multiple file names in word not allowed");
             }
-            filename_word = &std::get<FilenameWord>(element);
-            current_string = &postfix;
+            filename_index = index;
         }
     }
 
-    if (filename_variable || filename_word) {
-        std::vector<Filename> filenames;
-        if (filename_variable) {
-            filename_variable->collect_filenames(filenames);
+    if (filename_index == elements.size()) {
+        print_elements(output, 0, elements.size());
+        return;
+    }
+
+    std::vector<Filename> filenames;
+    const auto& element = elements[filename_index];
+    if (std::holds_alternative<FilenameWord>(element)) {
+        std::get<FilenameWord>(element).collect_filenames(filenames);
+    }
+    else {
+        std::get<const Variable*>(element)->as_filename()->collect_filenames(filenames);
+    }
+
+    auto first = true;
+    for (const auto& filename : filenames) {
+        if (first) {
+            first = false;
         }
         else {
-            filename_word->collect_filenames(filenames);
+            output << ' ';
         }
-        auto first = true;
-        for (const auto& filename : filenames) {
-            if (first) {
-                first = false;
-            }
-            else {
-                stream << " ";
-            }
-            stream << prefix << filename << postfix;
+        print_elements(output, 0, filename_index);
+        output << filename;
+        print_elements(output, filename_index + 1, elements.size());
+    }
+}
+
+void Word::collect_variable_references(StringSet& names) const {
+    for (const auto& element : elements) {
+        if (std::holds_alternative<VariableReference>(element)) {
+            names.insert(std::get<VariableReference>(element).name);
         }
     }
-    else {
-        stream << prefix;
+}
+
+void Word::print_elements(OutputBuffer& output, size_t begin, size_t end) const {
+    for (auto index = begin; index < end; index++) {
+        const auto& element = elements[index];
+        if (std::holds_alternative<StringElement>(element)) {
+            std::get<StringElement>(element).print(output);
+        }
+        else if (std::holds_alternative<VariableReference>(element)) {
+            output << '$' << std::get<VariableReference>(element).name;
+        }
+        else if (std::holds_alternative<const Variable*>(element)) {
+            output << std::get<const Variable*>(element)->string();
+        }
     }
 }
 
@@ -155,6 +157,10 @@ void Word::resolve(const ResolveContext& context) {
                     throw Exception("unknown variable {}", variable_reference.name);
                 }
             }
+            else {
+                // ninja expands it, but looking it up defines variables provided on demand, like host variables.
+                static_cast<void>(context.get_variable(std::get<VariableReference>(element).name));
+            }
         }
         else if (std::holds_alternative<FilenameWord>(element)) {
             auto& filename = std::get<FilenameWord>(element);
@@ -163,7 +169,7 @@ void Word::resolve(const ResolveContext& context) {
     }
 }
 
-std::ostream& operator<<(std::ostream& stream, const Word& word) {
-    word.print(stream);
-    return stream;
+OutputBuffer& operator<<(OutputBuffer& output, const Word& word) {
+    word.print(output);
+    return output;
 }
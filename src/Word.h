@@ -37,6 +37,7 @@ IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "FastNinjaUtil.h"
 #include "FilenameWord.h"
+#include "OutputBuffer.h"
 #include "VariableReference.h"
 
 class FilenameWord;
@@ -55,8 +56,11 @@ class Word {
 
     [[nodiscard]] bool is_resolved() const { return resolved; }
 
+    // Adds the names of variables not expanded by resolve.
+    void collect_variable_references(StringSet& names) const;
+
     [[nodiscard]] std::string string() const;
-    void print(std::ostream& stream) const;
+    void print(OutputBuffer& output) const;
 
     void resolve(const ResolveContext& scope);
 
@@ -67,17 +71,26 @@ class Word {
 
         StringElement() = default;
 
-        [[nodiscard]] std::string string() const { return escape ? dollar_escape(text) : text; }
+        void print(OutputBuffer& output) const {
+            if (escape) {
+                output.append_escaped(text);
+            }
+            else {
+                output << text;
+            }
+        }
 
       private:
         std::string text;
         bool escape{ false };
     };
 
+    void print_elements(OutputBuffer& output, size_t begin, size_t end) const;
+
     std::vector<std::variant<StringElement, VariableReference, const Variable*, FilenameWord>> elements;
     bool resolved{ true };
 };
 
-std::ostream& operator<<(std::ostream& stream, const Word& word);
+OutputBuffer& operator<<(OutputBuffer& output, const Word& word);
 
 #endif // WORD_H
@@ -0,0 +1,103 @@
+/*
+Copyright (C) Dieter Baron
+
+The authors can be contacted at <fast-ninja@tpau.group>
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+
+2. The names of the authors may not be used to endorse or promote
+  products derived from this software without specific prior
+  written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS
+OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "WorkerProtocol.h"
+
+#include <tpau-cpp-kernal/Exception.h>
+
+#include "FastNinjaUtil.h"
+
+using namespace tpau::cpp_kernal;
+
+namespace {
+template <typename T> T parse_field(std::string_view string) {
+    const auto value = parse_number<T>(string);
+    if (!value) {
+        throw Exception("invalid worker message");
+    }
+    return *value;
+}
+} // namespace
+
+std::string WorkerProtocol::encode_request(const std::vector<std::string>& arguments) {
+    auto message = std::to_string(arguments.size()) + '\n';
+    for (const auto& argument : arguments) {
+        if (argument.find('\n') != std::string::npos) {
+            throw Exception("worker arguments can't contain newlines");
+        }
+        message += argument;
+        message += '\n';
+    }
+    return message;
+}
+
+std::string WorkerProtocol::encode_response(const Response& response) { return std::to_string(response.exit_code) + ' ' + std::to_string(response.output.size()) + '\n' + response.output; }
+
+std::optional<std::vector<std::string>> WorkerProtocol::decode_request(std::string& buffer) {
+    const auto header_end = buffer.find('\n');
+    if (header_end == std::string::npos) {
+        return {};
+    }
+    const auto count = parse_field<size_t>(std::string_view(buffer).substr(0, header_end));
+
+    auto arguments = std::vector<std::string>{};
+    auto start = header_end + 1;
+    while (arguments.size() < count) {
+        const auto end = buffer.find('\n', start);
+        if (end == std::string::npos) {
+            return {};
+        }
+        arguments.emplace_back(buffer.substr(start, end - start));
+        start = end + 1;
+    }
+
+    buffer.erase(0, start);
+    return arguments;
+}
+
+std::optional<WorkerProtocol::Response> WorkerProtocol::decode_response(std::string& buffer) {
+    const auto header_end = buffer.find('\n');
+    if (header_end == std::string::npos) {
+        return {};
+    }
+    const auto header = std::string_view(buffer).substr(0, header_end);
+    const auto space = header.find(' ');
+    if (space == std::string_view::npos) {
+        throw Exception("invalid worker message");
+    }
+    const auto exit_code = parse_field<int>(header.substr(0, space));
+    const auto length = parse_field<size_t>(header.substr(space + 1));
+    if (buffer.size() - (header_end + 1) < length) {
+        return {};
+    }
+
+    auto response = Response{ exit_code, buffer.substr(header_end + 1, length) };
+    buffer.erase(0, header_end + 1 + length);
+    return response;
+}
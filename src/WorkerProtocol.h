@@ -0,0 +1,68 @@
+/*
+Copyright (C) Dieter Baron
+
+The authors can be contacted at <fast-ninja@tpau.group>
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+
+2. The names of the authors may not be used to endorse or promote
+  products derived from this software without specific prior
+  written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS
+OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef WORKER_PROTOCOL_H
+#define WORKER_PROTOCOL_H
+
+#include <optional>
+#include <string>
+#include <vector>
+
+/*
+ Messages exchanged between worker clients, the worker supervisor and workers.
+
+ request:  COUNT NEWLINE, followed by COUNT arguments, each followed by NEWLINE
+ response: EXIT-CODE SPACE LENGTH NEWLINE, followed by LENGTH bytes of output
+
+ Clients send the tool followed by its arguments. A worker is started as TOOL --persistent_worker and keeps running;
+ it reads requests for the arguments following the tool from standard input, and writes a response for each to standard output.
+ Diagnostics must be returned in the output.
+
+ The supervisor answers with exit code run_directly if no worker could handle the request, e.g. because the tool doesn't support
+ being run as a worker. The client then runs the tool itself.
+ */
+class WorkerProtocol {
+  public:
+    static constexpr int run_directly = -1;
+
+    class Response {
+      public:
+        int exit_code{};
+        std::string output;
+    };
+
+    [[nodiscard]] static std::string encode_request(const std::vector<std::string>& arguments);
+    [[nodiscard]] static std::string encode_response(const Response& response);
+
+    // Removes a complete message from the start of buffer and returns it, or returns nothing if buffer doesn't contain a complete message yet.
+    [[nodiscard]] static std::optional<std::vector<std::string>> decode_request(std::string& buffer);
+    [[nodiscard]] static std::optional<Response> decode_response(std::string& buffer);
+};
+
+#endif // WORKER_PROTOCOL_H
@@ -0,0 +1,482 @@
+/*
+Copyright (C) Dieter Baron
+
+The authors can be contacted at <fast-ninja@tpau.group>
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+
+2. The names of the authors may not be used to endorse or promote
+  products derived from this software without specific prior
+  written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS
+OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "config.h"
+
+#include "WorkerSupervisor.h"
+
+#include <iostream>
+
+#include <tpau-cpp-kernal/Exception.h>
+
+#include "FastNinjaUtil.h"
+#include "WorkerProtocol.h"
+
+#if defined(HAVE_EXECVP) && defined(HAVE_FORK) && defined(HAVE_SYS_UN_H)
+#define WORKERS_SUPPORTED
+#endif
+
+#ifdef WORKERS_SUPPORTED
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <thread>
+#include <cstdlib>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/file.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+using namespace tpau::cpp_kernal;
+
+#ifdef WORKERS_SUPPORTED
+namespace {
+volatile std::sig_atomic_t terminated = 0;
+
+void handle_sigterm(int /*signal*/) { terminated = 1; }
+
+void start_supervisor(const std::filesystem::path& socket_path) {
+    // ninja waits until every process holding the output pipe of a command has exited, so the supervisor is fully detached.
+    const auto pid = fork();
+    if (pid < 0) {
+        return;
+    }
+    if (pid == 0) {
+        setsid();
+        if (fork() == 0) {
+            if (const auto null_fd = open("/dev/null", O_RDWR); null_fd >= 0) {
+                dup2(null_fd, STDIN_FILENO);
+                dup2(null_fd, STDOUT_FILENO);
+                dup2(null_fd, STDERR_FILENO);
+            }
+            execlp("fast-ninja", "fast-ninja", "--worker-supervisor", socket_path.c_str(), nullptr);
+        }
+        _exit(0);
+    }
+    waitpid(pid, nullptr, 0);
+}
+
+[[noreturn]] void run_directly(const std::vector<std::string>& command) {
+    auto argv = std::vector<char*>{};
+    for (const auto& argument : command) {
+        argv.emplace_back(const_cast<char*>(argument.c_str()));
+    }
+    argv.emplace_back(nullptr);
+
+    std::cout.flush();
+    execvp(argv[0], argv.data());
+    throw Exception("can't run '{}': {}", command[0], std::strerror(errno));
+}
+} // namespace
+
+WorkerSupervisor::WorkerSupervisor(std::filesystem::path socket_path) : socket_path{ std::move(socket_path) }, fd{ listen_on_socket(this->socket_path) } {}
+
+WorkerSupervisor::~WorkerSupervisor() {
+    for (const auto& client : clients) {
+        close(client.fd);
+    }
+    for (auto& worker : workers) {
+        stop_worker(worker);
+    }
+    close(fd);
+    std::error_code error;
+    std::filesystem::remove(socket_path, error);
+}
+
+bool WorkerSupervisor::is_supported() { return true; }
+
+int WorkerSupervisor::client_main(const std::vector<std::string>& arguments) {
+    try {
+        if (arguments.size() < 3 || arguments[1] != "--") {
+            throw Exception("usage: fast-ninja --worker-client socket -- tool [argument ...]");
+        }
+        const auto socket_path = std::filesystem::path(arguments[0]);
+        const auto command = std::vector<std::string>(arguments.begin() + 2, arguments.end());
+
+        auto fd = connect_to_socket(socket_path);
+        if (fd < 0) {
+            start_supervisor(socket_path);
+            for (auto attempt = 0; fd < 0 && attempt < 50; attempt++) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+                fd = connect_to_socket(socket_path);
+            }
+        }
+        if (fd >= 0) {
+            auto input = std::string{};
+            const auto deadline = std::chrono::steady_clock::now() + response_timeout;
+            if (write_all(fd, WorkerProtocol::encode_request(command))) {
+                // A worker that hangs must not hang the build; closing the connection makes the supervisor stop it.
+                auto poll_fd = pollfd{ fd, POLLIN, 0 };
+                auto remaining = [&deadline]() { return static_cast<int>(std::max<int64_t>(0, std::chrono::ceil<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count())); };
+                while (poll(&poll_fd, 1, remaining()) > 0 && read_some(fd, input) > 0) {
+                    if (const auto response = WorkerProtocol::decode_response(input)) {
+                        close(fd);
+                        if (response->exit_code == WorkerProtocol::run_directly) {
+                            run_directly(command);
+                        }
+                        std::cout << response->output;
+                        std::cout.flush();
+                        return response->exit_code;
+                    }
+                }
+            }
+            close(fd);
+        }
+
+        // Workers only make the build faster, it works without them.
+        run_directly(command);
+    } catch (const std::exception& ex) {
+        std::cerr << "fast-ninja: " << ex.what() << '\n';
+        return 1;
+    }
+}
+
+int WorkerSupervisor::main(const std::vector<std::string>& arguments) {
+    try {
+        if (arguments.size() != 1) {
+            throw Exception("usage: fast-ninja --worker-supervisor socket");
+        }
+        // The lock is held until the supervisor exits. Binding the socket replaces a stale one, so only the holder of the lock may do it.
+        const auto lock_filename = arguments[0] + ".lock";
+        const auto lock_fd = open(lock_filename.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0666);
+        if (lock_fd < 0) {
+            throw Exception("can't create '{}': {}", lock_filename, std::strerror(errno));
+        }
+        if (flock(lock_fd, LOCK_EX | LOCK_NB) < 0) {
+            // Another client started a supervisor first.
+            close(lock_fd);
+            return 0;
+        }
+
+        // Clients and workers that went away are noticed when writing to them.
+        std::signal(SIGPIPE, SIG_IGN);
+        // Stop workers and remove the socket when terminated.
+        std::signal(SIGTERM, handle_sigterm);
+        auto supervisor = WorkerSupervisor{ arguments[0] };
+        supervisor.run();
+        return 0;
+    } catch (const std::exception& ex) {
+        std::cerr << "fast-ninja: " << ex.what() << '\n';
+        return 1;
+    }
+}
+
+void WorkerSupervisor::run() {
+    auto poll_fds = std::vector<pollfd>{};
+
+    while (true) {
+        poll_fds.clear();
+        poll_fds.push_back(pollfd{ fd, POLLIN, 0 });
+        for (const auto& client : clients) {
+            poll_fds.push_back(pollfd{ client.fd, POLLIN, 0 });
+        }
+        // Idle workers are watched as well, to notice when they exit.
+        for (const auto& worker : workers) {
+            poll_fds.push_back(pollfd{ worker.output_fd, POLLIN, 0 });
+        }
+        // Clients send nothing after their request, so readable means they gave up waiting. Idle workers have no client, which poll ignores.
+        for (const auto& worker : workers) {
+            poll_fds.push_back(pollfd{ worker.client_fd, POLLIN, 0 });
+        }
+
+        const auto ready = poll(poll_fds.data(), poll_fds.size(), poll_timeout());
+        if (terminated) {
+            return;
+        }
+        if (ready < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw Exception("can't wait for requests: {}", std::strerror(errno));
+        }
+        if (ready == 0 && clients.empty() && std::ranges::all_of(workers, [](const Worker& worker) { return worker.client_fd < 0; })) {
+            return;
+        }
+
+        // Workers are handled first and from the back, so removing them doesn't invalidate the indices. Dispatching may add workers.
+        const auto worker_count = workers.size();
+        for (size_t i = worker_count; i > 0; i--) {
+            auto& worker = workers[i - 1];
+            auto usable = poll_fds[1 + clients.size() + i - 1].revents == 0 || handle_output(worker);
+            if (usable && worker.client_fd >= 0 && poll_fds[1 + clients.size() + worker_count + i - 1].revents != 0) {
+                // The client runs the tool itself now, so the worker must not write the outputs as well.
+                usable = false;
+            }
+            if (!usable) {
+                stop_worker(worker);
+                workers.erase(workers.begin() + static_cast<std::ptrdiff_t>(i - 1));
+            }
+        }
+
+        for (size_t i = clients.size(); i > 0; i--) {
+            if (poll_fds[i].revents == 0) {
+                continue;
+            }
+            auto& client = clients[i - 1];
+            auto request = std::optional<std::vector<std::string>>{};
+            auto open = read_some(client.fd, client.input) > 0;
+            if (open) {
+                try {
+                    request = WorkerProtocol::decode_request(client.input);
+                } catch (const Exception&) {
+                    open = false;
+                }
+            }
+            if (!open || request) {
+                const auto client_fd = client.fd;
+                clients.erase(clients.begin() + static_cast<std::ptrdiff_t>(i - 1));
+                if (request) {
+                    dispatch(client_fd, std::move(*request));
+                }
+                else {
+                    close(client_fd);
+                }
+            }
+        }
+
+        // A tool that doesn't support being a worker may not exit either, but it won't answer.
+        const auto now = std::chrono::steady_clock::now();
+        for (size_t i = workers.size(); i > 0; i--) {
+            if (is_unproven(workers[i - 1]) && now - workers[i - 1].started >= first_response_timeout) {
+                fail(workers[i - 1]);
+                stop_worker(workers[i - 1]);
+                workers.erase(workers.begin() + static_cast<std::ptrdiff_t>(i - 1));
+            }
+        }
+
+        if (poll_fds[0].revents & POLLIN) {
+            if (const auto client_fd = accept4(fd, nullptr, nullptr, SOCK_CLOEXEC); client_fd >= 0) {
+                clients.emplace_back(client_fd);
+            }
+        }
+    }
+}
+
+void WorkerSupervisor::dispatch(int client_fd, std::vector<std::string> arguments) {
+    if (arguments.empty()) {
+        respond(client_fd, 1, "fast-ninja: no tool given\n");
+        return;
+    }
+    const auto tool = std::move(arguments.front());
+    arguments.erase(arguments.begin());
+
+    const auto version = find_tool(tool);
+    if (!version || failed_tools.contains(tool)) {
+        respond(client_fd, WorkerProtocol::run_directly, "");
+        return;
+    }
+
+    // Workers of a tool that was rebuilt since they started would run the old binary. Busy ones are replaced once they're done.
+    for (auto i = workers.size(); i > 0; i--) {
+        if (workers[i - 1].tool == tool && workers[i - 1].version != *version && workers[i - 1].client_fd < 0) {
+            stop_worker(workers[i - 1]);
+            workers.erase(workers.begin() + static_cast<std::ptrdiff_t>(i - 1));
+        }
+    }
+
+    auto worker = std::ranges::find_if(workers, [&](const Worker& worker) { return worker.client_fd < 0 && worker.tool == tool && worker.version == *version; });
+    if (worker == workers.end()) {
+        auto new_worker = Worker{};
+        new_worker.tool = tool;
+        new_worker.version = *version;
+        new_worker.started = std::chrono::steady_clock::now();
+        try {
+            start_worker(new_worker);
+        } catch (const Exception&) {
+            respond(client_fd, WorkerProtocol::run_directly, "");
+            return;
+        }
+        workers.emplace_back(std::move(new_worker));
+        worker = workers.end() - 1;
+    }
+
+    worker->client_fd = client_fd;
+    if (!write_all(worker->input_fd, WorkerProtocol::encode_request(arguments))) {
+        fail(*worker);
+        stop_worker(*worker);
+        workers.erase(worker);
+    }
+}
+
+bool WorkerSupervisor::handle_output(Worker& worker) {
+    if (read_some(worker.output_fd, worker.output) <= 0) {
+        fail(worker);
+        return false;
+    }
+    try {
+        if (const auto response = WorkerProtocol::decode_response(worker.output)) {
+            worker.answered = true;
+            working_tools.insert(worker.tool);
+            if (worker.client_fd >= 0) {
+                respond(worker.client_fd, response->exit_code, response->output);
+                worker.client_fd = -1;
+            }
+        }
+        return true;
+    } catch (const Exception&) {
+        fail(worker);
+        return false;
+    }
+}
+
+void WorkerSupervisor::fail(Worker& worker) {
+    if (is_unproven(worker)) {
+        failed_tools.insert(worker.tool);
+    }
+    if (worker.client_fd >= 0) {
+        respond(worker.client_fd, WorkerProtocol::run_directly, "");
+        worker.client_fd = -1;
+    }
+}
+
+bool WorkerSupervisor::is_unproven(const Worker& worker) const { return worker.client_fd >= 0 && !worker.answered && !working_tools.contains(worker.tool); }
+
+int WorkerSupervisor::poll_timeout() const {
+    auto timeout = std::chrono::milliseconds(idle_timeout);
+    const auto now = std::chrono::steady_clock::now();
+    for (const auto& worker : workers) {
+        if (is_unproven(worker)) {
+            timeout = std::min(timeout, std::max(std::chrono::milliseconds(0), std::chrono::ceil<std::chrono::milliseconds>(worker.started + first_response_timeout - now)));
+        }
+    }
+    return static_cast<int>(timeout.count());
+}
+
+std::optional<WorkerSupervisor::ToolVersion> WorkerSupervisor::find_tool(const std::string& tool) {
+    const auto program = find_program(tool);
+    struct stat st {};
+    if (!program || stat(program->c_str(), &st) != 0) {
+        return {};
+    }
+    auto error = std::error_code{};
+    const auto modification_time = std::filesystem::last_write_time(*program, error);
+    return ToolVersion{ static_cast<uint64_t>(st.st_dev), static_cast<uint64_t>(st.st_ino), static_cast<int64_t>(modification_time.time_since_epoch().count()) };
+}
+
+void WorkerSupervisor::respond(int client_fd, int exit_code, const std::string& output) {
+    write_all(client_fd, WorkerProtocol::encode_response(WorkerProtocol::Response{ exit_code, output }));
+    close(client_fd);
+}
+
+void WorkerSupervisor::start_worker(Worker& worker) {
+    int to_worker[2];
+    int from_worker[2];
+    if (pipe(to_worker) < 0) {
+        throw Exception("can't start worker {}: {}", worker.tool, std::strerror(errno));
+    }
+    if (pipe(from_worker) < 0) {
+        const auto error = errno;
+        close(to_worker[0]);
+        close(to_worker[1]);
+        throw Exception("can't start worker {}: {}", worker.tool, std::strerror(error));
+    }
+
+    const auto pid = fork();
+    if (pid < 0) {
+        const auto error = errno;
+        for (const auto pipe_fd : { to_worker[0], to_worker[1], from_worker[0], from_worker[1] }) {
+            close(pipe_fd);
+        }
+        throw Exception("can't start worker {}: {}", worker.tool, std::strerror(error));
+    }
+    if (pid == 0) {
+        dup2(to_worker[0], STDIN_FILENO);
+        dup2(from_worker[1], STDOUT_FILENO);
+        for (const auto pipe_fd : { to_worker[0], to_worker[1], from_worker[0], from_worker[1] }) {
+            close(pipe_fd);
+        }
+        execlp(worker.tool.c_str(), worker.tool.c_str(), "--persistent_worker", nullptr);
+        _exit(127);
+    }
+
+    close(to_worker[0]);
+    close(from_worker[1]);
+    fcntl(to_worker[1], F_SETFD, FD_CLOEXEC);
+    fcntl(from_worker[0], F_SETFD, FD_CLOEXEC);
+    worker.pid = pid;
+    worker.input_fd = to_worker[1];
+    worker.output_fd = from_worker[0];
+}
+
+void WorkerSupervisor::stop_worker(Worker& worker) {
+    if (worker.client_fd >= 0) {
+        close(worker.client_fd);
+        worker.client_fd = -1;
+    }
+    close(worker.input_fd);
+    close(worker.output_fd);
+    kill(worker.pid, SIGTERM);
+    waitpid(worker.pid, nullptr, 0);
+}
+
+#else
+
+WorkerSupervisor::WorkerSupervisor(std::filesystem::path socket_path) : socket_path{ std::move(socket_path) } { throw Exception("workers are not supported on this platform"); }
+
+WorkerSupervisor::~WorkerSupervisor() = default;
+
+bool WorkerSupervisor::is_supported() { return false; }
+
+int WorkerSupervisor::client_main(const std::vector<std::string>& /*arguments*/) {
+    std::cerr << "fast-ninja: workers are not supported on this platform\n";
+    return 1;
+}
+
+int WorkerSupervisor::main(const std::vector<std::string>& /*arguments*/) {
+    std::cerr << "fast-ninja: workers are not supported on this platform\n";
+    return 1;
+}
+
+void WorkerSupervisor::run() { throw Exception("workers are not supported on this platform"); }
+
+std::optional<WorkerSupervisor::ToolVersion> WorkerSupervisor::find_tool(const std::string& /*tool*/) { return {}; }
+
+void WorkerSupervisor::dispatch(int /*client_fd*/, std::vector<std::string> /*arguments*/) {}
+
+bool WorkerSupervisor::handle_output(Worker& /*worker*/) { return false; }
+
+void WorkerSupervisor::fail(Worker& /*worker*/) {}
+
+bool WorkerSupervisor::is_unproven(const Worker& /*worker*/) const { return false; }
+
+int WorkerSupervisor::poll_timeout() const { return idle_timeout; }
+
+void WorkerSupervisor::respond(int /*client_fd*/, int /*exit_code*/, const std::string& /*output*/) {}
+
+void WorkerSupervisor::start_worker(Worker& /*worker*/) {}
+
+void WorkerSupervisor::stop_worker(Worker& /*worker*/) {}
+
+#endif
@@ -0,0 +1,135 @@
+/*
+Copyright (C) Dieter Baron
+
+The authors can be contacted at <fast-ninja@tpau.group>
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+
+2. The names of the authors may not be used to endorse or promote
+  products derived from this software without specific prior
+  written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS
+OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef WORKER_SUPERVISOR_H
+#define WORKER_SUPERVISOR_H
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <set>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/*
+ Keeps persistent workers running and passes requests from worker clients to idle workers of the requested tool, starting new ones as needed.
+ It is started by the first client that finds no supervisor listening on the socket, and exits when no request arrived for a while or on SIGTERM.
+ Tools whose first worker exits or doesn't answer its first request in time are run directly by the clients.
+ Workers are replaced when the binary of their tool changed, e.g. because the build rebuilt it.
+ A lock file next to the socket ensures only one supervisor runs.
+ See WorkerProtocol for the messages exchanged.
+ */
+class WorkerSupervisor {
+  public:
+    explicit WorkerSupervisor(std::filesystem::path socket_path);
+    ~WorkerSupervisor();
+    WorkerSupervisor(const WorkerSupervisor&) = delete;
+    WorkerSupervisor& operator=(const WorkerSupervisor&) = delete;
+
+    // Relative to the top build directory.
+    static constexpr std::string_view socket_name = ".fast-ninja-workers";
+
+    [[nodiscard]] static bool is_supported();
+
+    // Runs the client used by rules with worker = 1: SOCKET -- TOOL ARGUMENT ...
+    // If no supervisor can be reached or no worker can handle the request, the tool is run directly.
+    static int client_main(const std::vector<std::string>& arguments);
+    // Runs the supervisor: SOCKET
+    static int main(const std::vector<std::string>& arguments);
+
+    // Serves requests until none arrived for idle_timeout or SIGTERM was received.
+    void run();
+
+  private:
+    static constexpr int idle_timeout = 60 * 1000;
+    static constexpr auto first_response_timeout = std::chrono::seconds(30);
+    // Clients give up on hung workers after this and run the tool directly.
+    static constexpr auto response_timeout = std::chrono::minutes(10);
+
+    // Identifies the binary of a tool.
+    class ToolVersion {
+      public:
+        uint64_t device{};
+        uint64_t inode{};
+        int64_t modification_time{};
+
+        bool operator==(const ToolVersion& other) const = default;
+    };
+
+    class Client {
+      public:
+        explicit Client(int fd) : fd{ fd } {}
+
+        int fd;
+        std::string input;
+    };
+
+    class Worker {
+      public:
+        std::string tool;
+        ToolVersion version;
+        int pid{ -1 };
+        int input_fd{ -1 };
+        int output_fd{ -1 };
+        std::string output;
+        // The client waiting for the response to the current request, -1 if idle.
+        int client_fd{ -1 };
+        bool answered{ false };
+        std::chrono::steady_clock::time_point started;
+    };
+
+    // Returns the version of the binary that running tool would execute, nothing if there is none.
+    [[nodiscard]] static std::optional<ToolVersion> find_tool(const std::string& tool);
+
+    void dispatch(int client_fd, std::vector<std::string> arguments);
+    // Returns false if the worker can't be used anymore.
+    bool handle_output(Worker& worker);
+    // Lets the waiting client run the tool directly, and all further clients if the tool never worked.
+    void fail(Worker& worker);
+    // Returns whether worker is still waiting for the answer to its first request and may not support being a worker.
+    [[nodiscard]] bool is_unproven(const Worker& worker) const;
+    // Returns the time to wait for events in milliseconds.
+    [[nodiscard]] int poll_timeout() const;
+    static void respond(int client_fd, int exit_code, const std::string& output);
+    static void start_worker(Worker& worker);
+    static void stop_worker(Worker& worker);
+
+    std::filesystem::path socket_path;
+    int fd{ -1 };
+    std::vector<Client> clients;
+    std::vector<Worker> workers;
+    // Tools for which a worker answered a request.
+    std::set<std::string, std::less<>> working_tools;
+    // Tools that are run directly.
+    std::set<std::string, std::less<>> failed_tools;
+};
+
+#endif // WORKER_SUPERVISOR_H
@@ -29,17 +29,40 @@ IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "config.h"
 
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <limits>
+#include <set>
+
+#ifdef HAVE_EXECVP
+#include <unistd.h>
+#endif
 
 #include <tpau-cpp-kernal/Command.h>
+#include <tpau-cpp-kernal/DiagnosticOutput.h>
+#include <tpau-cpp-kernal/Exception.h>
 
+#include "ActionCache.h"
+#include "BuildGraph.h"
+#include "BuildLocations.h"
+#include "FastNinjaUtil.h"
 #include "File.h"
+#include "NinjaLog.h"
+#include "Query.h"
+#include "QueryIndex.h"
+#include "QueryServer.h"
+#include "RegenerationState.h"
+#include "Report.h"
+#include "Watcher.h"
+#include "WorkerSupervisor.h"
 
 using namespace tpau::cpp_kernal;
 
 class fast_ninja : public Command {
   public:
-    fast_ninja() : Command(options, "top-source-directory", "fast-ninja") {}
+    fast_ninja() : Command(options, "top-source-directory [-- ninja-argument ...]", "fast-ninja") {}
 
     virtual ~fast_ninja() = default;
 
@@ -47,29 +70,347 @@ class fast_ninja : public Command {
     void process() override;
     void create_output() override;
 
-    size_t maximum_arguments() override { return 1; }
+    // Additional arguments are passed to ninja by --build.
+    size_t maximum_arguments() override { return std::numeric_limits<size_t>::max(); }
 
-    size_t minimum_arguments() override { return 1; }
+    // --report needs no top source directory.
+    size_t minimum_arguments() override { return 0; }
 
   private:
     static std::vector<Commandline::Option> options;
 
+    void analyze(const std::optional<std::string>& ninja_log);
+    void query(std::string_view type, std::string_view subject) const;
+    void regenerate();
+    static void report(const std::filesystem::path& ninja_log);
+    [[noreturn]] static void run_ninja(const std::vector<std::string>& ninja_arguments);
+    [[noreturn]] void serve(const std::filesystem::path& socket_path);
+    [[noreturn]] void watch();
+    void watch_sources(Watcher& watcher) const;
+
+    std::filesystem::path top_source_file;
+    Options generator_options;
     std::unique_ptr<File> file;
 };
 
-std::vector<Commandline::Option> fast_ninja::options = {};
+std::vector<Commandline::Option> fast_ninja::options = {
+    Commandline::Option("analyze", "report longest dependency chain, fan-in, fan-out, duplicate outputs and cycles"),
+    Commandline::Option("build", "regenerate if needed, then run ninja with the arguments after --"),
+    Commandline::Option("cache", "directory", "cache outputs of rules with cache = 1 in directory"),
+    Commandline::Option("cache-size", "megabytes", "limit size of cache (default 1024)"),
+    Commandline::Option("clean-stale", "remove outputs that are no longer built (requires built-files-list)"),
+    Commandline::Option("index", "write an index of builds and variables for --query"),
+    Commandline::Option("locations", "write where each build is defined for --report"),
+    Commandline::Option("prune", "leave out builds not needed for default targets, roots or regeneration"),
+    Commandline::Option("query", "type", "answer query (producer, consumers, var, targets) for argument using the index"),
+    Commandline::Option("report", "ninja-log", "report slowest builds, rules, files and directories from ninja log"),
+    Commandline::Option("root", "target", "also keep builds needed for target when pruning (may be given multiple times)"),
+    Commandline::Option("serve", "socket", "answer queries about the build graph on Unix domain socket"),
+    Commandline::Option("tune-from", "ninja-log", "suggest priorities and pools from build times in ninja log"),
+    Commandline::Option("watch", "keep running and regenerate whenever a source changes"),
+};
 
 int main(int argc, char* argv[]) {
+    // The launchers of cached and worker rules take file names and commands, which must not be parsed as options.
+    if (argc > 1 && std::string_view(argv[1]) == "--cached-exec") {
+        return ActionCache::main({ argv + 2, argv + argc });
+    }
+    if (argc > 1 && std::string_view(argv[1]) == "--worker-client") {
+        return WorkerSupervisor::client_main({ argv + 2, argv + argc });
+    }
+    if (argc > 1 && std::string_view(argv[1]) == "--worker-supervisor") {
+        return WorkerSupervisor::main({ argv + 2, argv + argc });
+    }
+
     auto command = fast_ninja();
 
     return command.run(argc, argv);
 }
 
 void fast_ninja::process() {
+    const auto build = arguments.find_last("build").has_value();
+    if (!build && arguments.arguments.size() > 1) {
+        throw Exception("too many arguments");
+    }
+
+    if (const auto ninja_log = arguments.find_last("report")) {
+        if (!arguments.arguments.empty()) {
+            throw Exception("too many arguments");
+        }
+        report(*ninja_log);
+        return;
+    }
+    if (arguments.arguments.empty()) {
+        throw Exception("missing top source directory");
+    }
+    if (const auto type = arguments.find_last("query")) {
+        query(*type, arguments.arguments[0]);
+        return;
+    }
+
     const auto top_source_directory = std::filesystem::path(arguments.arguments[0]);
+    top_source_file = top_source_directory / "build.fninja";
+
+    if (const auto cache_directory = arguments.find_last("cache")) {
+        generator_options.cache_directory = *cache_directory;
+    }
+    if (const auto cache_size = arguments.find_last("cache-size")) {
+        const auto size = parse_number<uint64_t>(*cache_size);
+        if (!size || *size == 0) {
+            throw Exception("invalid cache size '{}'", *cache_size);
+        }
+        generator_options.cache_size = *size;
+    }
+    generator_options.clean_stale = arguments.find_last("clean-stale").has_value();
+    generator_options.index = arguments.find_last("index").has_value();
+    generator_options.locations = arguments.find_last("locations").has_value();
+    generator_options.prune = arguments.find_last("prune").has_value();
+    generator_options.roots = arguments.find_all("root");
+    if (!generator_options.roots.empty() && !generator_options.prune) {
+        throw Exception("--root requires --prune");
+    }
+
+    if (const auto ninja_log = arguments.find_last("tune-from"); ninja_log || arguments.find_last("analyze").has_value()) {
+        analyze(ninja_log);
+        return;
+    }
+
+    if (const auto socket_path = arguments.find_last("serve")) {
+        if (!QueryServer::is_supported()) {
+            throw Exception("--serve is not supported on this platform");
+        }
+        serve(*socket_path);
+    }
+
+    if (arguments.find_last("watch").has_value()) {
+        if (!Watcher::is_supported()) {
+            throw Exception("--watch is not supported on this platform");
+        }
+        watch();
+    }
+
+    regenerate();
+
+    if (build) {
+        create_output();
+        file.reset();
+        run_ninja({ arguments.arguments.begin() + 1, arguments.arguments.end() });
+    }
+}
+
+void fast_ninja::analyze(const std::optional<std::string>& ninja_log) {
+    // The graph needs all builds resolved, so files that are up to date can't be skipped.
+    // Nothing is written, so the build files stay as they are.
+    auto analyzed_file = File{ top_source_file };
+    analyzed_file.options = generator_options;
+    analyzed_file.process(false);
+
+    const auto graph = BuildGraph{ analyzed_file };
+    auto output = OutputBuffer{};
+    if (ninja_log) {
+        graph.print_tuning(output, NinjaLog{ *ninja_log });
+    }
+    else {
+        graph.print_analysis(output);
+    }
+    std::cout << output.string();
+}
+
+void fast_ninja::report(const std::filesystem::path& ninja_log) {
+    // The log is in the build directory, which all other files are found relative to, so the report works from anywhere.
+    const auto build_directory = ninja_log.parent_path();
+    const auto log = NinjaLog{ ninja_log };
+    auto report = Report{ log, build_directory };
+    for (const auto& ninja_file : RegenerationState{ RegenerationState::filename(build_directory) }.ninja_files()) {
+        report.add(BuildLocations::read(BuildLocations::filename(build_directory / ninja_file)));
+    }
+
+    auto output = OutputBuffer{};
+    report.print(output);
+    std::cout << output.string();
+}
+
+void fast_ninja::run_ninja(const std::vector<std::string>& ninja_arguments) {
+    // The build files are up to date now, so ninja loads them only once.
+    std::cout.flush();
+    std::cerr.flush();
+
+#ifdef HAVE_EXECVP
+    auto argv = std::vector<char*>{};
+    argv.emplace_back(const_cast<char*>("ninja"));
+    for (const auto& argument : ninja_arguments) {
+        argv.emplace_back(const_cast<char*>(argument.c_str()));
+    }
+    argv.emplace_back(nullptr);
+
+    execvp("ninja", argv.data());
+    throw Exception("can't run ninja: {}", std::strerror(errno));
+#else
+    auto command = std::string{ "ninja" };
+    for (const auto& argument : ninja_arguments) {
+        command += " " + shell_quote(argument);
+    }
+    std::exit(exit_status(std::system(command.c_str())));
+#endif
+}
+
+void fast_ninja::query(std::string_view type, std::string_view subject) const {
+    const auto ninja_files = RegenerationState{ RegenerationState::filename(".") }.ninja_files();
+
+    auto indices = std::vector<std::unique_ptr<QueryIndex>>{};
+    for (const auto& ninja_file : ninja_files) {
+        auto index = std::make_unique<QueryIndex>(QueryIndex::filename(ninja_file));
+        if (!index->is_valid()) {
+            throw Exception("no valid index for '{}', run fast-ninja with --index", ninja_file.string());
+        }
+        indices.emplace_back(std::move(index));
+    }
+    if (indices.empty()) {
+        throw Exception("no index found, run fast-ninja with --index");
+    }
 
-    file = std::make_unique<File>(top_source_directory / "build.fninja");
+    auto index_for_directory = [&](std::string_view directory) -> const QueryIndex& {
+        const auto normalized = std::filesystem::path(directory).lexically_normal();
+        for (size_t i = 0; i < ninja_files.size(); i++) {
+            const auto ninja_directory = ninja_files[i].parent_path();
+            if ((ninja_directory.empty() ? std::filesystem::path(".") : ninja_directory) == normalized) {
+                return *indices[i];
+            }
+        }
+        throw Exception("no ninja file for directory '{}'", std::string(directory));
+    };
+
+    auto results = std::vector<std::string_view>{};
+    if (type == "producer" || type == "consumers") {
+        const auto file = std::filesystem::path(subject).lexically_normal().generic_string();
+        for (const auto& index : indices) {
+            const auto values = index->find(type == "producer" ? QueryIndex::PRODUCERS : QueryIndex::CONSUMERS, file);
+            results.insert(results.end(), values.begin(), values.end());
+        }
+        if (results.empty() && type == "producer") {
+            throw Exception("no build creates '{}'", file);
+        }
+    }
+    else if (type == "var") {
+        const auto at = subject.find('@');
+        results = index_for_directory(at == std::string_view::npos ? "." : subject.substr(at + 1)).find(QueryIndex::VARIABLES, subject.substr(0, at));
+        if (results.empty()) {
+            throw Exception("unknown variable '{}'", std::string(subject.substr(0, at)));
+        }
+    }
+    else if (type == "targets") {
+        results = index_for_directory(subject).keys(QueryIndex::PRODUCERS);
+    }
+    else {
+        throw Exception("unknown query type '{}'", std::string(type));
+    }
+
+    for (const auto& result : results) {
+        std::cout << result << '\n';
+    }
+}
+
+void fast_ninja::regenerate() {
+    file.reset();
+
+    if (const auto state = RegenerationState{ RegenerationState::filename(".") }; state.is_up_to_date(top_source_file, generator_options.arguments())) {
+        // ninja removes the depfile after reading it, and would forget the dependencies if we didn't provide it again.
+        state.write_depfile(RegenerationState::depfile_filename("."));
+        return;
+    }
+
+    file = std::make_unique<File>(top_source_file);
+    file->options = generator_options;
     file->process();
 }
 
-void fast_ninja::create_output() { file->create_output(); }
+void fast_ninja::serve(const std::filesystem::path& socket_path) {
+    auto load = [this]() {
+        // Queries need all builds resolved, so files that are up to date can't be skipped.
+        file = std::make_unique<File>(top_source_file);
+        file->options = generator_options;
+        file->process(false);
+        file->create_output();
+        return std::make_unique<Query>(*file);
+    };
+    auto is_current = [this]() { return RegenerationState{ RegenerationState::filename(".") }.is_up_to_date(top_source_file, generator_options.arguments()); };
+
+    auto server = QueryServer{ socket_path, load, is_current };
+    server.run();
+}
+
+void fast_ninja::watch() {
+    while (true) {
+        // Watches are added before regenerating, so that changes made while generating are noticed.
+        auto watcher = Watcher{};
+        watch_sources(watcher);
+
+        auto succeeded = false;
+        try {
+            regenerate();
+            create_output();
+            succeeded = true;
+        } catch (const Exception& ex) {
+            // Errors in the sources are reported, but don't end watching; the next change may fix them.
+            if (*ex.what() != '\0') {
+                DiagnosticOutput::global.error("{}", ex.what());
+            }
+        }
+        file.reset();
+
+        if (succeeded) {
+            // Sources first used in this run were only watched now, so check they weren't changed since they were parsed.
+            watch_sources(watcher);
+            if (!RegenerationState{ RegenerationState::filename(".") }.is_up_to_date(top_source_file, generator_options.arguments())) {
+                continue;
+            }
+        }
+
+        watcher.wait();
+    }
+}
+
+void fast_ninja::watch_sources(Watcher& watcher) const {
+    // Watch the directories of everything the last successful run depended on, so that edits as well as newly created files are noticed.
+    const auto top_directory = top_source_file.parent_path().empty() ? std::filesystem::path(".") : top_source_file.parent_path();
+    auto directories = std::set<std::filesystem::path>{ top_directory };
+    const auto dependencies = RegenerationState{ RegenerationState::filename(".") }.dependencies();
+    for (const auto& dependency : dependencies) {
+        const auto path = std::filesystem::path(dependency);
+        if (std::filesystem::is_directory(path)) {
+            directories.insert(path);
+        }
+        else {
+            directories.insert(path.parent_path().empty() ? "." : path.parent_path());
+        }
+    }
+
+    if (dependencies.empty()) {
+        // Without a successful run, the sources are unknown; watch the whole source tree except the build directory.
+        auto error = std::error_code{};
+        for (auto it = std::filesystem::recursive_directory_iterator(top_directory, std::filesystem::directory_options::skip_permission_denied, error); !error && it != std::filesystem::recursive_directory_iterator(); it.increment(error)) {
+            if (!it->is_directory(error)) {
+                continue;
+            }
+            if (std::filesystem::equivalent(it->path(), ".", error)) {
+                it.disable_recursion_pending();
+                continue;
+            }
+            directories.insert(it->path());
+        }
+    }
+
+    for (const auto& directory : directories) {
+        try {
+            watcher.add(directory);
+        } catch (const Exception&) {
+            // The directory may have been removed since; changes to it can't matter then.
+        }
+    }
+}
+
+void fast_ninja::create_output() {
+    if (file) {
+        file->create_output();
+    }
+}
@@ -0,0 +1,75 @@
+/*
+Copyright (C) Dieter Baron
+
+The authors can be contacted at <fast-ninja@tpau.group>
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+
+2. The names of the authors may not be used to endorse or promote
+  products derived from this software without specific prior
+  written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS
+OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/*
+ Worker for tests of rules with worker = 1: answers each request with its number and arguments, and exit code 1 if the first argument is fail.
+ Run without --persistent_worker, it prints its arguments directly.
+ */
+
+#include <array>
+#include <iostream>
+#include <string>
+#include <string_view>
+
+#include <unistd.h>
+
+#include "WorkerProtocol.h"
+
+int main(int argc, char* argv[]) {
+    if (argc < 2 || std::string_view(argv[1]) != "--persistent_worker") {
+        std::cout << "echo-worker directly:";
+        for (auto i = 1; i < argc; i++) {
+            std::cout << ' ' << argv[i];
+        }
+        std::cout << '\n';
+        return 0;
+    }
+
+    auto input = std::string{};
+    auto count = 0;
+    while (true) {
+        while (const auto request = WorkerProtocol::decode_request(input)) {
+            count++;
+            auto response = WorkerProtocol::Response{ !request->empty() && request->front() == "fail" ? 1 : 0, "echo-worker request " + std::to_string(count) + ":" };
+            for (const auto& argument : *request) {
+                response.output += ' ' + argument;
+            }
+            response.output += '\n';
+            std::cout << WorkerProtocol::encode_response(response);
+            std::cout.flush();
+        }
+
+        auto chunk = std::array<char, 4096>{};
+        const auto n = read(STDIN_FILENO, chunk.data(), chunk.size());
+        if (n <= 0) {
+            return 0;
+        }
+        input.append(chunk.data(), static_cast<size_t>(n));
+    }
+}
@@ -0,0 +1,477 @@
+/*
+Copyright (C) Dieter Baron
+
+The authors can be contacted at <fast-ninja@tpau.group>
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+
+2. The names of the authors may not be used to endorse or promote
+  products derived from this software without specific prior
+  written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS
+OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/*
+ Runs a script of steps, for tests that need more than one run of fast-ninja.
+ The script is given as the only argument, each line is one step:
+
+ run ARGUMENT ...     run fast-ninja with arguments, print its exit code if it isn't 0
+ write FILE TEXT      replace the contents of FILE by line TEXT
+ append FILE TEXT     append line TEXT to FILE
+ executable FILE TEXT replace FILE by a shell script running TEXT
+ edit FILE REGEX TEXT replace matches of REGEX, which can't contain spaces, in FILE by TEXT
+ remove FILE          remove FILE, or directory FILE with its contents
+ serve SOCKET ARGUMENT ...
+                      start fast-ninja --serve in the background and wait until it accepts connections
+ query SOCKET REQUEST print the answer to REQUEST
+ hangup SOCKET REQUEST
+                      send REQUEST and close the connection without reading the answer
+ flood SOCKET REQUEST send REQUEST until the server stops reading, and never read the answers
+ watch ARGUMENT ...   start fast-ninja --watch in the background and wait until it has generated the output
+ watch-failing ARGUMENT ...
+                      start fast-ninja --watch in the background, whose first run is expected to fail
+ observe FILE         start recording writes of FILE
+ written FILE         wait for writes of FILE, print how often it was written since observe
+ stop                 terminate the process started in the background
+ stop-supervisor SOCKET
+                      terminate the worker supervisor listening on SOCKET and wait until it removed the socket
+ */
+
+#include "config.h"
+
+#include <array>
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <regex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef HAVE_INOTIFY
+#include <sys/inotify.h>
+#endif
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace {
+pid_t background_pid = -1;
+std::string background_socket;
+// Connections kept open until the driver exits.
+std::vector<int> flooded_fds;
+int observer_fd = -1;
+std::string observed_name;
+
+std::vector<std::string> split(const std::string& line) {
+    auto words = std::vector<std::string>{};
+    auto stream = std::istringstream{ line };
+    auto word = std::string{};
+    while (stream >> word) {
+        words.emplace_back(word);
+    }
+    return words;
+}
+
+// Returns the text following the first count words of line.
+std::string rest(const std::string& line, size_t count) {
+    auto position = size_t{ 0 };
+    for (size_t i = 0; i < count; i++) {
+        position = line.find(' ', line.find_first_not_of(' ', position));
+        if (position == std::string::npos) {
+            return "";
+        }
+    }
+    return line.substr(position + 1);
+}
+
+pid_t start(const std::vector<std::string>& arguments) {
+    std::cout.flush();
+    const auto pid = fork();
+    if (pid < 0) {
+        throw std::runtime_error(std::string("can't fork: ") + std::strerror(errno));
+    }
+    if (pid == 0) {
+        auto argv = std::vector<char*>{};
+        for (const auto& argument : arguments) {
+            argv.emplace_back(const_cast<char*>(argument.c_str()));
+        }
+        argv.emplace_back(nullptr);
+        execvp(argv[0], argv.data());
+        std::cerr << "can't run " << arguments[0] << ": " << std::strerror(errno) << '\n';
+        _exit(127);
+    }
+    return pid;
+}
+
+int finish(pid_t pid) {
+    auto status = 0;
+    while (waitpid(pid, &status, 0) < 0) {
+        if (errno != EINTR) {
+            throw std::runtime_error(std::string("can't wait for child: ") + std::strerror(errno));
+        }
+    }
+    return WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+}
+
+void run(std::vector<std::string> arguments) {
+    arguments.insert(arguments.begin(), "fast-ninja");
+    if (const auto exit_code = finish(start(arguments)); exit_code != 0) {
+        std::cout << "exit " << exit_code << '\n';
+    }
+}
+
+// Returns -1 if nobody listens on the socket.
+int connect_to(const std::string& socket_path) {
+    auto address = sockaddr_un{};
+    address.sun_family = AF_UNIX;
+    if (socket_path.size() >= sizeof(address.sun_path)) {
+        throw std::runtime_error("socket path '" + socket_path + "' too long");
+    }
+    std::strcpy(address.sun_path, socket_path.c_str());
+
+    const auto fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        throw std::runtime_error(std::string("can't create socket: ") + std::strerror(errno));
+    }
+    if (connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int send_request(const std::string& socket_path, const std::string& request) {
+    const auto fd = connect_to(socket_path);
+    if (fd < 0) {
+        throw std::runtime_error("can't connect to '" + socket_path + "'");
+    }
+    const auto data = request + "\n";
+    if (send(fd, data.data(), data.size(), MSG_NOSIGNAL) != static_cast<ssize_t>(data.size())) {
+        close(fd);
+        throw std::runtime_error("can't send request to '" + socket_path + "'");
+    }
+    return fd;
+}
+
+void serve(const std::string& socket_path, std::vector<std::string> arguments) {
+    arguments.insert(arguments.begin(), { "fast-ninja", "--serve", socket_path });
+    background_pid = start(arguments);
+    background_socket = socket_path;
+
+    for (auto i = 0; i < 100; i++) {
+        if (const auto fd = connect_to(socket_path); fd >= 0) {
+            close(fd);
+            return;
+        }
+        if (waitpid(background_pid, nullptr, WNOHANG) == background_pid) {
+            background_pid = -1;
+            throw std::runtime_error("server exited");
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    throw std::runtime_error("server didn't start");
+}
+
+void query(const std::string& socket_path, const std::string& request) {
+    const auto fd = send_request(socket_path, request);
+    auto answer = std::string{};
+    auto buffer = std::array<char, 4096>{};
+    // The answer ends with an empty line.
+    while (!answer.ends_with("\n\n") && answer != "\n") {
+        auto poll_fd = pollfd{ fd, POLLIN, 0 };
+        if (poll(&poll_fd, 1, 10000) <= 0) {
+            close(fd);
+            throw std::runtime_error("no answer from server");
+        }
+        const auto n = read(fd, buffer.data(), buffer.size());
+        if (n <= 0) {
+            close(fd);
+            throw std::runtime_error("connection closed before end of answer");
+        }
+        answer.append(buffer.data(), static_cast<size_t>(n));
+    }
+    close(fd);
+    std::cout << answer.substr(0, answer.size() - 1);
+}
+
+void watch(std::vector<std::string> arguments, bool failing) {
+    arguments.insert(arguments.begin(), { "fast-ninja", "--watch" });
+    background_pid = start(arguments);
+
+    if (failing) {
+        // Nothing is generated, so give it time to fail and start watching.
+        std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+        return;
+    }
+
+    for (auto i = 0; i < 100 && access(".fast-ninja-state", F_OK) != 0; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    if (access(".fast-ninja-state", F_OK) != 0) {
+        throw std::runtime_error("output wasn't generated");
+    }
+    // Give it time to start watching.
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+}
+
+#ifdef HAVE_INOTIFY
+void observe(const std::string& filename) {
+    const auto slash = filename.rfind('/');
+    const auto directory = slash == std::string::npos ? std::string{ "." } : filename.substr(0, slash);
+    observed_name = slash == std::string::npos ? filename : filename.substr(slash + 1);
+
+    if ((observer_fd = inotify_init1(IN_CLOEXEC)) < 0 || inotify_add_watch(observer_fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+        throw std::runtime_error("can't observe '" + filename + "': " + std::strerror(errno));
+    }
+}
+
+// Returns the number of writes of the observed file that arrive within timeout.
+size_t count_writes(int timeout) {
+    auto count = size_t{ 0 };
+    auto poll_fd = pollfd{ observer_fd, POLLIN, 0 };
+    while (count == 0 && poll(&poll_fd, 1, timeout) > 0) {
+        alignas(inotify_event) auto buffer = std::array<char, 4096>{};
+        const auto n = read(observer_fd, buffer.data(), buffer.size());
+        for (auto offset = ssize_t{ 0 }; offset < n;) {
+            const auto event = reinterpret_cast<const inotify_event*>(buffer.data() + offset);
+            if (event->len > 0 && observed_name == event->name) {
+                count++;
+            }
+            offset += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+        }
+    }
+    return count;
+}
+
+void written(const std::string& filename) {
+    if (observer_fd < 0) {
+        throw std::runtime_error("nothing observed");
+    }
+    auto count = count_writes(10000);
+    if (count > 0) {
+        // Collect writes caused by the same change.
+        for (auto more = count_writes(1000); more > 0; more = count_writes(1000)) {
+            count += more;
+        }
+    }
+    close(observer_fd);
+    observer_fd = -1;
+    std::cout << "writes of " << filename << ": " << count << '\n';
+}
+#else
+void observe(const std::string& /*filename*/) { throw std::runtime_error("observing files is not supported on this platform"); }
+
+void written(const std::string& /*filename*/) { throw std::runtime_error("observing files is not supported on this platform"); }
+#endif
+
+void flood(const std::string& socket_path, const std::string& request) {
+    const auto fd = send_request(socket_path, request);
+    flooded_fds.push_back(fd);
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+
+    const auto data = request + "\n";
+    auto sent = data.size();
+    // The server is done reading once sending failed for a while.
+    for (auto idle = 0; idle < 5 && sent < 64 * 1024 * 1024;) {
+        if (const auto n = send(fd, data.data(), data.size(), MSG_NOSIGNAL); n > 0) {
+            sent += static_cast<size_t>(n);
+            idle = 0;
+        }
+        else if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+            throw std::runtime_error(std::string("can't send requests: ") + std::strerror(errno));
+        }
+        else {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            idle++;
+        }
+    }
+}
+
+void stop() {
+    if (background_pid < 0) {
+        throw std::runtime_error("nothing started in the background");
+    }
+    kill(background_pid, SIGTERM);
+    finish(background_pid);
+    background_pid = -1;
+    // Terminated servers don't clean up after themselves.
+    if (!background_socket.empty()) {
+        unlink(background_socket.c_str());
+        background_socket.clear();
+    }
+}
+
+void stop_supervisor(const std::string& socket_path) {
+#ifdef SO_PEERCRED
+    const auto fd = connect_to(socket_path);
+    if (fd < 0) {
+        throw std::runtime_error("no supervisor listening on '" + socket_path + "'");
+    }
+    auto credentials = ucred{};
+    auto length = socklen_t{ sizeof(credentials) };
+    const auto ok = getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &credentials, &length) == 0;
+    close(fd);
+    if (!ok) {
+        throw std::runtime_error(std::string("can't get supervisor process: ") + std::strerror(errno));
+    }
+    kill(credentials.pid, SIGTERM);
+
+    for (auto i = 0; i < 100 && access(socket_path.c_str(), F_OK) == 0; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    if (access(socket_path.c_str(), F_OK) == 0) {
+        throw std::runtime_error("supervisor didn't remove '" + socket_path + "'");
+    }
+#else
+    throw std::runtime_error("stopping the supervisor is not supported on this platform");
+#endif
+}
+
+void write_file(const std::string& filename, const std::string& text, std::ios::openmode mode) {
+    auto stream = std::ofstream{ filename, mode };
+    stream << text << '\n';
+    if (!stream) {
+        throw std::runtime_error("can't write '" + filename + "'");
+    }
+}
+
+void write_script(const std::string& filename, const std::string& text) {
+    write_file(filename, "#!/bin/sh\n" + text, std::ios::trunc);
+    if (chmod(filename.c_str(), 0755) < 0) {
+        throw std::runtime_error("can't make '" + filename + "' executable: " + std::strerror(errno));
+    }
+}
+
+void edit_file(const std::string& filename, const std::string& pattern, const std::string& replacement) {
+    auto stream = std::ifstream{ filename };
+    if (!stream) {
+        throw std::runtime_error("can't read '" + filename + "'");
+    }
+    const auto regex = std::regex{ pattern };
+    auto text = std::string{};
+    auto line = std::string{};
+    while (std::getline(stream, line)) {
+        text += std::regex_replace(line, regex, replacement) + '\n';
+    }
+    stream.close();
+
+    auto output = std::ofstream{ filename };
+    output << text;
+    if (!output) {
+        throw std::runtime_error("can't write '" + filename + "'");
+    }
+}
+
+void step(const std::string& line) {
+    const auto words = split(line);
+    if (words.empty()) {
+        return;
+    }
+    const auto& command = words[0];
+
+    if (command == "run") {
+        run({ words.begin() + 1, words.end() });
+    }
+    else if ((command == "write" || command == "append") && words.size() >= 2) {
+        write_file(words[1], rest(line, 2), command == "append" ? std::ios::app : std::ios::trunc);
+    }
+    else if (command == "executable" && words.size() >= 2) {
+        write_script(words[1], rest(line, 2));
+    }
+    else if (command == "edit" && words.size() >= 3) {
+        edit_file(words[1], words[2], rest(line, 3));
+    }
+    else if (command == "remove" && words.size() == 2) {
+        std::filesystem::remove_all(words[1]);
+    }
+    else if (command == "serve" && words.size() >= 2) {
+        serve(words[1], { words.begin() + 2, words.end() });
+    }
+    else if (command == "query" && words.size() >= 3) {
+        query(words[1], rest(line, 2));
+    }
+    else if (command == "flood" && words.size() >= 3) {
+        flood(words[1], rest(line, 2));
+    }
+    else if (command == "hangup" && words.size() >= 3) {
+        close(send_request(words[1], rest(line, 2)));
+    }
+    else if (command == "watch" || command == "watch-failing") {
+        watch({ words.begin() + 1, words.end() }, command == "watch-failing");
+    }
+    else if (command == "observe" && words.size() == 2) {
+        observe(words[1]);
+    }
+    else if (command == "written" && words.size() == 2) {
+        written(words[1]);
+    }
+    else if (command == "stop-supervisor" && words.size() == 2) {
+        stop_supervisor(words[1]);
+    }
+    else if (command == "stop") {
+        stop();
+    }
+    else {
+        throw std::runtime_error("invalid step '" + line + "'");
+    }
+}
+} // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc != 2) {
+        std::cerr << "usage: " << argv[0] << " script\n";
+        return 1;
+    }
+
+    // Use the fast-ninja just built, which is also what starts further instances of itself, a stub for ninja that shows how --build runs it, and the worker for tests of workers.
+    const auto path = getenv("PATH");
+    setenv("PATH", (std::string(FAST_NINJA_DIRECTORY) + ":" + NINJA_STUB_DIRECTORY + ":" + ECHO_WORKER_DIRECTORY + (path ? std::string(":") + path : "")).c_str(), 1);
+
+    try {
+        auto script = std::ifstream{ argv[1] };
+        if (!script) {
+            throw std::runtime_error(std::string("can't open '") + argv[1] + "'");
+        }
+        auto line = std::string{};
+        while (std::getline(script, line)) {
+            step(line);
+        }
+    } catch (const std::exception& ex) {
+        std::cerr << argv[0] << ": " << ex.what() << '\n';
+        if (background_pid >= 0) {
+            stop();
+        }
+        return 1;
+    }
+    if (background_pid >= 0) {
+        stop();
+    }
+    return 0;
+}